@@ -2,8 +2,8 @@
 // -*-
 #include "moma.h"
 
-// Initializer for PCA
-MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
+// Initializer for PCA. All other initializers delegate to it.
+MoMA::MoMA(std::unique_ptr<LinearOperator> i_X,
            /*
             * sparsity - enforced through penalties
             */
@@ -17,8 +17,8 @@ MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
             */
            double i_alpha_u,  // Smoothing levels
            double i_alpha_v,
-           const arma::mat &i_Omega_u,  // Smoothing matrices
-           const arma::mat &i_Omega_v,
+           const arma::sp_mat &i_Omega_u,  // Smoothing matrices
+           const arma::sp_mat &i_Omega_v,
 
            /*
             * Algorithm parameters:
@@ -27,19 +27,32 @@ MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
            long i_MAX_ITER,
            double i_EPS_inner,
            long i_MAX_ITER_inner,
+           double i_EPS_init,
            std::string i_solver,
-           DeflationScheme i_ds)
-    : n(i_X.n_rows),
-      p(i_X.n_cols),
+           DeflationScheme i_ds,
+           bool i_symmetric)
+    : n(i_X->n_rows()),
+      p(i_X->n_cols()),
       alpha_u(i_alpha_u),
       alpha_v(i_alpha_v),
       lambda_u(i_lambda_u),
       lambda_v(i_lambda_v),
-      X(i_X),  // no copy of the data
-      Omega_u(i_Omega_u),
-      Omega_v(i_Omega_v),
+      X_base(std::move(i_X)),
+      X_op(*X_base),
+      ds(i_ds),
+      Xv_cache(false),
+      Xtu_cache(true),
+      is_symmetric(i_symmetric),
+      is_u_unpenalized(Rcpp::as<std::string>(i_prox_arg_list_u["P"]) == "NONE"),
+      n_plain_iter(0),
+      is_gram_cached(false),
       MAX_ITER(i_MAX_ITER),
       EPS(i_EPS),
+      EPS_inner(i_EPS_inner),
+      EPS_init(i_EPS_init),
+      outer_acceleration(false),
+      n_outer_iter(0),
+      n_inner_iter(0),
       solver_u(i_solver,
                alpha_u,
                i_Omega_u,
@@ -47,7 +60,7 @@ MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
                i_prox_arg_list_u,
                i_EPS_inner,
                i_MAX_ITER_inner,
-               i_X.n_rows),
+               n),
       solver_v(i_solver,
                alpha_v,
                i_Omega_v,
@@ -55,15 +68,15 @@ MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
                i_prox_arg_list_v,
                i_EPS_inner,
                i_MAX_ITER_inner,
-               i_X.n_cols)
-// const reference must be passed to initializer list
+               p)
 {
-    ds         = i_ds;
-    X_original = i_X;
-
-    if (i_EPS >= 1 || i_EPS_inner >= 1)
+    if (i_EPS >= 1 || i_EPS_inner >= 1 || i_EPS_init >= 1)
+    {
+        MoMALogger::error("EPS, EPS_inner or EPS_init too large.");
+    }
+    if (is_symmetric && (n != p || !is_pca_mode()))
     {
-        MoMALogger::error("EPS or EPS_inner too large.");
+        MoMALogger::error("Symmetric mode requires a square matrix and a PCA deflation scheme.");
     }
 
     bicsr_u.bind(&solver_u, &PR_solver::bic);
@@ -74,7 +87,7 @@ MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
         << " alpha_v " << alpha_v << " P_u " << Rcpp::as<std::string>(i_prox_arg_list_u["P"])
         << " P_v " << Rcpp::as<std::string>(i_prox_arg_list_v["P"]) << " EPS " << i_EPS
         << " MAX_ITER " << i_MAX_ITER << " EPS_inner " << i_EPS_inner << " MAX_ITER_inner "
-        << i_MAX_ITER_inner << " solver " << i_solver;
+        << i_MAX_ITER_inner << " solver " << i_solver << " EPS_init " << i_EPS_init;
     // Step 2: Initialize to leading singular vectors
     //
     //         MoMA is a regularized SVD, which is a non-convex (bi-convex)
@@ -85,44 +98,68 @@ MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
     //         lie near the SVD solution; for problems with significant
     //         regularization the problem becomes more well-behaved and less
     //         sensitive to initialization
+    is_deflated   = false;
+    is_svd_cached = false;
     initialize_uv();
+    u_svd_original = u_svd;
+    v_svd_original = v_svd;
+
     is_initialzied = true;
     is_solved      = false;  // TODO: check if alphauv == 0
 };
 
-// Initializer for LDA and CCA
-MoMA::MoMA(
-    // const arma::mat &X_,  // Pass X_ as a reference to avoid copy
-    const arma::mat &i_X_working,
-    const arma::mat &i_Y_working,
-    /*
-     * sparsity - enforced through penalties
-     */
-    double i_lambda_u,  // regularization level
-    double i_lambda_v,
-    Rcpp::List i_prox_arg_list_u,
-    Rcpp::List i_prox_arg_list_v,
-
-    /*
-     * smoothness - enforced through constraints
-     */
-    double i_alpha_u,  // Smoothing levels
-    double i_alpha_v,
-    const arma::mat &i_Omega_u,  // Smoothing matrices
-    const arma::mat &i_Omega_v,
-
-    /*
-     * Algorithm parameters:
-     */
-    double i_EPS,
-    long i_MAX_ITER,
-    double i_EPS_inner,
-    long i_MAX_ITER_inner,
-    std::string i_solver,
-    DeflationScheme i_ds)
-    : MoMA(i_X_working.t() * i_Y_working,  // the matrix on which we find pSVD
-           i_lambda_u,
+// Whether we form X^T Y explicitly in CCA mode. We compare the
+// costs of a matrix-vector product, O(pq) against O(n (p + q)).
+// Sparse matrices are never multiplied out.
+bool form_cross_product(const LinearOperator &X, const LinearOperator &Y)
+{
+    return !X.is_sparse() && !Y.is_sparse() &&
+           (double)X.n_cols() * Y.n_cols() <= (double)X.n_rows() * (X.n_cols() + Y.n_cols());
+}
+
+std::unique_ptr<LinearOperator> new_cross_product(const LinearOperator &X, const LinearOperator &Y)
+{
+    if (form_cross_product(X, Y))
+    {
+        MoMALogger::debug("X^T Y is formed.");
+        return std::unique_ptr<LinearOperator>(new DenseOperator(X.dense().t() * Y.dense()));
+    }
+    MoMALogger::debug("X^T Y is not formed.");
+    return std::unique_ptr<LinearOperator>(new CrossProductOperator(X, Y));
+}
+
+// Initializer for CCA, where we find the pSVD of X^T Y
+MoMA::MoMA(std::unique_ptr<LinearOperator> i_X,
+           std::unique_ptr<LinearOperator> i_Y,
+           /*
+            * sparsity - enforced through penalties
+            */
+           double i_lambda_u,  // regularization level
+           double i_lambda_v,
+           Rcpp::List i_prox_arg_list_u,
+           Rcpp::List i_prox_arg_list_v,
+
+           /*
+            * smoothness - enforced through constraints
+            */
+           double i_alpha_u,  // Smoothing levels
+           double i_alpha_v,
+           const arma::sp_mat &i_Omega_u,  // Smoothing matrices
+           const arma::sp_mat &i_Omega_v,
+
+           /*
+            * Algorithm parameters:
+            */
+           double i_EPS,
+           long i_MAX_ITER,
+           double i_EPS_inner,
+           long i_MAX_ITER_inner,
+           double i_EPS_init,
+           std::string i_solver,
+           DeflationScheme i_ds)
+    : MoMA(new_cross_product(*i_X, *i_Y),
            i_lambda_u,
+           i_lambda_v,
            i_prox_arg_list_u,
            i_prox_arg_list_v,
            i_alpha_u,
@@ -133,36 +170,73 @@ MoMA::MoMA(
            i_MAX_ITER,
            i_EPS_inner,
            i_MAX_ITER_inner,
+           i_EPS_init,
            i_solver,
-           i_ds)
+           DeflationScheme::CCA)
 {
-    if (ds == DeflationScheme::CCA)
+    // i_X and i_Y are released by their own destructors if the target
+    // constructor throws; once we get here MoMA owns them
+    X_data    = std::move(i_X);
+    Y_data    = std::move(i_Y);
+    X_working = std::unique_ptr<DeflatedOperator>(new DeflatedOperator(*X_data));
+    Y_working = std::unique_ptr<DeflatedOperator>(new DeflatedOperator(*Y_data));
+    if (i_ds != DeflationScheme::CCA)
     {
-        // const matrix
-        X_original = i_X_working;
-        Y_original = i_Y_working;
-
-        // deflated matrices
-        X_working = i_X_working;
-        Y_working = i_Y_working;
+        MoMALogger::error("Error in MoMA CCA initialzation.");
     }
-    else if (ds == DeflationScheme::LDA)
-    {
-        MoMALogger::debug("Initializing MoMA LDA mode.");
-        // const matrix
-        X_original = i_X_working;
-        Y_original = i_Y_working;
+};
 
-        // deflated matrices
-        X_working = i_X_working;
-        // we do not need Y_working
-        // since Y is an indicator matrix
-        MoMALogger::debug(" X_target = \n") << X;
-    }
-    else
-    {
-        MoMALogger::error("Error in MoMA LDA initialzation.");
-    }
+// Initializer for LDA, where we find the pSVD of X^T Y with Y the
+// class indicator matrix. Y is never formed, see `ClassIndicator`.
+MoMA::MoMA(const arma::mat &i_X,  // Pass X_ as a reference to avoid copy
+           ClassIndicator i_Y,
+           /*
+            * sparsity - enforced through penalties
+            */
+           double i_lambda_u,  // regularization level
+           double i_lambda_v,
+           Rcpp::List i_prox_arg_list_u,
+           Rcpp::List i_prox_arg_list_v,
+
+           /*
+            * smoothness - enforced through constraints
+            */
+           double i_alpha_u,  // Smoothing levels
+           double i_alpha_v,
+           const arma::sp_mat &i_Omega_u,  // Smoothing matrices
+           const arma::sp_mat &i_Omega_v,
+
+           /*
+            * Algorithm parameters:
+            */
+           double i_EPS,
+           long i_MAX_ITER,
+           double i_EPS_inner,
+           long i_MAX_ITER_inner,
+           double i_EPS_init,
+           std::string i_solver)
+    // X^T Y is only p x K
+    : MoMA(std::unique_ptr<LinearOperator>(new DenseOperator(i_Y.cross_product(i_X))),
+           i_lambda_u,
+           i_lambda_v,
+           i_prox_arg_list_u,
+           i_prox_arg_list_v,
+           i_alpha_u,
+           i_alpha_v,
+           i_Omega_u,
+           i_Omega_v,
+           i_EPS,
+           i_MAX_ITER,
+           i_EPS_inner,
+           i_MAX_ITER_inner,
+           i_EPS_init,
+           i_solver,
+           DeflationScheme::LDA)
+{
+    MoMALogger::debug("Initializing MoMA LDA mode.");
+    Y_indicator = std::move(i_Y);
+    X_data      = std::unique_ptr<LinearOperator>(new DenseOperator(i_X));
+    X_working   = std::unique_ptr<DeflatedOperator>(new DeflatedOperator(*X_data));
 };
 
 arma::vec normalize(const arma::vec &u)
@@ -186,45 +260,56 @@ int MoMA::deflate()
     {
         MoMALogger::error("Please call `MoMA::solve` before `MoMA::deflate`.");
     }
+
+    // MoMA::X is about to change, and so is its SVD
+    is_deflated   = true;
+    is_svd_cached = false;
+    Xv_cache.clear();
+    Xtu_cache.clear();
+    is_gram_cached = false;
     if (ds == DeflationScheme::PCA_Hotelling)
     {
-        double d = arma::as_scalar(u.t() * X * v);
+        double d = X_op.bilinear(u, v);
         MoMALogger::debug("Deflating:\n")
-            << "\nX = \n"
-            << X << "u^T = " << u.t() << "v^T = " << v.t() << "d = u^TXv = " << d;
+            << "u^T = " << u.t() << "v^T = " << v.t() << "d = u^TXv = " << d;
 
         if (d <= 0.0)
         {
             MoMALogger::error("Cannot deflate by non-positive factor.");
         }
-        X = X - d * u * v.t();
+        // X = X - d * u * v^T
+        X_op.subtract(d * u, v);
         // Re-initialize u and v after deflation
         initialize_uv();
         return 0;
     }
     else if (ds == DeflationScheme::PCA_Schur_complement)
     {
-        double d = arma::as_scalar(u.t() * X * v);
+        arma::vec Xv = X_op.times(v);
+        double d     = arma::dot(u, Xv);
         if (d <= 0.0)
         {
             MoMALogger::error("Error in Schur complement: devided by zero.");
         }
 
         // No need to scale u and v
-        X = X - (X * v) * (u.t() * X) / d;
+        // X = X - (X * v) * (u^T * X) / d
+        arma::vec Xtu = X_op.trans_times(u);
+        X_op.subtract(Xv, Xtu / d);
 
         initialize_uv();
         return 0;
     }
     else if (ds == DeflationScheme::PCA_Projection)
     {
-        arma::mat eye_u(n, n, arma::fill::eye);
-        arma::mat eye_v(p, p, arma::fill::eye);
-
         arma::vec u_unit = normalize(u);
         arma::vec v_unit = normalize(v);
 
-        X = (eye_u - u_unit * u_unit.t()) * X * (eye_v - v_unit * v_unit.t());
+        // X = (I - u u^T) X (I - v v^T), as two rank-1 updates
+        // X = X - u (u^T X)
+        // X = X - (X v) v^T
+        X_op.subtract(u_unit, X_op.trans_times(u_unit));
+        X_op.subtract(X_op.times(v_unit), v_unit);
 
         initialize_uv();
         return 0;
@@ -241,16 +326,23 @@ int MoMA::deflate()
 
         // u and v are scores
         // "cv" = canonical variates
-        arma::mat X_cv   = X_working * u;
-        arma::mat Y_cv   = Y_working * v;
+        arma::vec X_cv   = X_working->times(u);
+        arma::vec Y_cv   = Y_working->times(v);
         double norm_X_cv = arma::norm(X_cv);
         double norm_Y_cv = arma::norm(Y_cv);
 
-        // subtract cv's out of X_working and Y_working
-        X_working = X_working - 1 / (norm_X_cv * norm_X_cv) * X_cv * X_cv.t() * X_working;
-        Y_working = Y_working - 1 / (norm_Y_cv * norm_Y_cv) * Y_cv * Y_cv.t() * Y_working;
+        // Subtract cv's out of X_working and Y_working by rank-1 updates
+        // X_working = X_working - X_cv (X_cv^T X_working) / ||X_cv||^2
+        // Y_working = Y_working - Y_cv (Y_cv^T Y_working) / ||Y_cv||^2
+        // and keep X = X_working^T Y_working up-to-date
+        // with the induced rank-1 corrections.
+        arma::vec X_loading = X_working->trans_times(X_cv) / (norm_X_cv * norm_X_cv);
+        X_op.subtract(X_loading, Y_working->trans_times(X_cv));
+        X_working->subtract(X_cv, X_loading);
 
-        X = X_working.t() * Y_working;
+        arma::vec Y_loading = Y_working->trans_times(Y_cv) / (norm_Y_cv * norm_Y_cv);
+        X_op.subtract(X_working->trans_times(Y_cv), Y_loading);
+        Y_working->subtract(Y_cv, Y_loading);
 
         initialize_uv();
         return 0;
@@ -267,13 +359,13 @@ int MoMA::deflate()
 
         // u and v are scores
         // "cv" = canonical variates
-        arma::mat X_cv   = X_working * u;
+        arma::vec X_cv   = X_working->times(u);
         double norm_X_cv = arma::norm(X_cv);
 
-        // subtract cv's out of X_working only
-        X_working = X_working - 1 / (norm_X_cv * norm_X_cv) * X_cv * X_cv.t() * X_working;
-
-        X = X_working.t() * Y_original;
+        // subtract cv's out of X_working only, see the CCA case
+        arma::vec X_loading = X_working->trans_times(X_cv) / (norm_X_cv * norm_X_cv);
+        X_op.subtract(X_loading, Y_indicator.trans_times(X_cv));
+        X_working->subtract(X_cv, X_loading);
 
         initialize_uv();
         return 0;
@@ -287,41 +379,155 @@ int MoMA::deflate()
 // Dependence on MoMA's internal states: MoMA::X, MoMA::u, MoMA::v, MoMA::alpha_u/v,
 // MoMA::lambda_u/v
 // After calling MoMA::solve(), MoMA::u and MoMA::v become the solution to the penalized regression.
+//
+// The outer loop is a fixed-point iteration v -> T(v), where T(v) is the v found
+// by solving for u given v, and then for v given u. With MoMA::outer_acceleration,
+// the next v fed into T is extrapolated from the past iterates, see
+// `AndersonAcceleration`. MoMA::u and MoMA::v are always outputs of T.
+//
+// In the Gram matrix fast path (see MoMA::use_gram), u is only formed
+// once after the loop. In symmetric mode, u is v.
 void MoMA::solve()
 {
-    double tol = 1;
-    int iter   = 0;
+    double tol   = 1;
+    int iter     = 0;
+    bool is_gram = use_gram(alpha_u);
     arma::vec oldu;
     arma::vec oldv;
-    while (tol > EPS && iter < MAX_ITER)
+    arma::vec v_in = v;  // the input of T
+    AndersonAcceleration aa;
+
+    // Solving the PR problems precisely is wasted while u and v are far
+    // from the fixed point, so the inner precision starts loose and is
+    // tightened along the outer loop. The outer loop only stops after an
+    // iteration at EPS_inner, so the solution is as precise as before.
+    double eps_inner = std::max(EPS_inner, MOMA_INEXACT_EPS_INIT);
+    double eps_used  = eps_inner;
+    n_inner_iter     = 0;
+    while ((tol > EPS || eps_used > EPS_inner) && iter < MAX_ITER)
     {
         iter++;
-        oldu = u;
-        oldv = v;
-
-        u = solver_u.solve(X * v, u);
-        v = solver_v.solve(X.t() * u, v);
+        oldu     = u;
+        oldv     = v;
+        eps_used = eps_inner;
+        solver_u.set_EPS(eps_used);
+        solver_v.set_EPS(eps_used);
+
+        // switch to the fast path once it pays off, see MoMA::use_gram
+        is_gram = is_gram || use_gram(alpha_u);
+        if (is_symmetric)
+        {
+            v = solver_v.solve(Xv_cache.times(X_op, v_in), v);
+        }
+        else if (is_gram)
+        {
+            v = solver_v.solve(gram_y_v(v_in), v);
+        }
+        else
+        {
+            u = solver_u.solve(Xv_cache.times(X_op, v_in), u);
+            n_inner_iter += solver_u.iterations();
+            v = solver_v.solve(Xtu_cache.times(X_op, u), v);
+            n_plain_iter++;
+        }
+        n_inner_iter += solver_v.iterations();
 
         double scale_u = arma::norm(oldu) == 0.0 ? 1 : arma::norm(oldu);
         double scale_v = arma::norm(oldv) == 0.0 ? 1 : arma::norm(oldv);
 
-        tol = arma::norm(oldu - u) / scale_u + arma::norm(oldv - v) / scale_v;
-        MoMALogger::debug("Real-time PG loop info:  (iter, tol) = (") << iter << ", " << tol << ")";
+        tol       = arma::norm(oldu - u) / scale_u + arma::norm(oldv - v) / scale_v;
+        eps_inner = std::max(EPS_inner, std::min(MOMA_INEXACT_EPS_SHRINK * eps_inner,
+                                                 MOMA_INEXACT_EPS_RATIO * tol));
+        v_in      = outer_acceleration ? aa.next(v_in, v) : v;
+        MoMALogger::debug("Real-time PG loop info:  (iter, tol, EPS_inner) = (")
+            << iter << ", " << tol << ", " << eps_used << ")";
+    }
+    // the BIC search calls the solvers directly
+    solver_u.set_EPS(EPS_inner);
+    solver_v.set_EPS(EPS_inner);
+    if (is_symmetric)
+    {
+        u = v;
     }
+    else if (is_gram)
+    {
+        u = solver_u.solve(X_op.times(v), u);
+    }
+    n_outer_iter = iter;
 
-    MoMALogger::info("Finish PG loop. Total iter = ") << iter;
+    MoMALogger::info("Finish PG loop. Total iter = ")
+        << iter << ", total inner iter = " << n_inner_iter;
+    if (outer_acceleration)
+    {
+        MoMALogger::info("Rejected extrapolations: ") << aa.n_rejected;
+    }
     check_convergence(iter, tol);
     is_solved = true;
 }
 
+bool MoMA::is_pca_mode() const
+{
+    return ds == DeflationScheme::PCA_Hotelling || ds == DeflationScheme::PCA_Schur_complement ||
+           ds == DeflationScheme::PCA_Projection;
+}
+
+bool MoMA::use_gram(double i_alpha_u) const
+{
+    if (!is_u_unpenalized || i_alpha_u != 0.0)
+    {
+        return false;
+    }
+    if (is_symmetric || !is_pca_mode())
+    {
+        return false;
+    }
+    return gram_base.n_elem > 0 ||
+           (!X_base->is_sparse() && n >= MOMA_GRAM_RATIO * p && 2 * n_plain_iter >= p);
+}
+
+arma::vec MoMA::gram_y_v(const arma::vec &v)
+{
+    if (!is_gram_cached)
+    {
+        if (gram_base.n_elem == 0)
+        {
+            MoMALogger::info("Forming the Gram matrix.");
+            gram_base = X_base->gram();
+        }
+        gram           = X_op.gram(gram_base);
+        is_gram_cached = true;
+    }
+    arma::vec Gv   = gram * v;
+    double norm_Xv = std::sqrt(std::max(arma::dot(v, Gv), 0.0));
+    if (norm_Xv > 0)
+    {
+        Gv /= norm_Xv;
+    }
+    else
+    {
+        Gv.zeros();
+    }
+    return Gv;
+}
+
+void MoMA::set_gram(const arma::mat &G)
+{
+    if ((int)G.n_rows != p || (int)G.n_cols != p)
+    {
+        MoMALogger::error("The Gram matrix should be p x p, where X is n x p.");
+    }
+    gram_base      = G;
+    is_gram_cached = false;
+}
+
 double MoMA::evaluate_loss()
 {
     if (!is_solved)
     {
         MoMALogger::error("Please call MoMA::solve first before MoMA::evaluate_loss.");
     }
-    double u_ellipsoid_constraint = arma::as_scalar(u.t() * u + alpha_u * u.t() * Omega_u * u);
-    double v_ellipsoid_constraint = arma::as_scalar(v.t() * v + alpha_v * v.t() * Omega_v * v);
+    double u_ellipsoid_constraint = std::pow(solver_u.S_norm(u), 2);
+    double v_ellipsoid_constraint = std::pow(solver_v.S_norm(v), 2);
 
     if ((std::abs(u_ellipsoid_constraint) > MOMA_FLOATPOINT_EPS &&
          std::abs(u_ellipsoid_constraint - 1.0) > MOMA_FLOATPOINT_EPS) ||
@@ -341,12 +547,42 @@ int MoMA::initialize_uv()
     // the solution of pSVD with only smoothness constraints.
 
     // Set MoMA::v, MoMA::u as leading SVs of X
-    arma::mat U;
-    arma::vec s;
-    arma::mat V;
-    arma::svd(U, s, V, X);
-    v              = V.col(0);
-    u              = U.col(0);
+    if (is_svd_cached)
+    {
+        u = u_svd;
+        v = v_svd;
+        is_initialzied = true;
+        return 0;
+    }
+
+    if (is_symmetric)
+    {
+        // The leading singular vector of a PSD matrix is its
+        // leading eigenvector
+        double d;
+        leading_eigenpair(X_op, v, d, EPS_init);
+        u = v;
+    }
+    else if (std::min(X_op.n_rows(), X_op.n_cols()) <= MOMA_LANCZOS_MIN_DIM && !X_op.is_sparse())
+    {
+        arma::mat U;
+        arma::vec s;
+        arma::mat V;
+        arma::svd(U, s, V, X_op.dense());
+        v = V.col(0);
+        u = U.col(0);
+    }
+    else
+    {
+        // We only need the leading singular pair, so a full SVD
+        // is wasteful for large matrices, and a sparse matrix is
+        // only touched through matrix-vector products
+        double d;
+        leading_singular_triplet(X_op, u, v, d, EPS_init);
+    }
+    u_svd          = u;
+    v_svd          = v;
+    is_svd_cached  = true;
     is_initialzied = true;
     return 0;
 }
@@ -386,30 +622,37 @@ int MoMA::set_penalty(double newlambda_u, double newlambda_v, double newalpha_u,
     return 0;
 }
 
+// Restore MoMA::X to the undeflated matrix, and MoMA::u and MoMA::v
+// to its leading SVs. Both are cached, so no SVD is computed here.
 int MoMA::reset_X()
 {
-    if (ds == DeflationScheme::PCA_Hotelling || ds == DeflationScheme::PCA_Schur_complement ||
-        ds == DeflationScheme::PCA_Projection)
+    if (is_deflated)
     {
-        X = X_original;
-        initialize_uv();
-        return 0;
-    }
-    else if (ds == DeflationScheme::CCA)
-    {
-        X_working = X_original;
-        Y_working = Y_original;
-        X         = X_working.t() * Y_working;
-        initialize_uv();
-        return 0;
-    }
-    else if (ds == DeflationScheme::LDA)
-    {
-        X_working = X_original;
-        X         = X_working.t() * Y_original;
-    }
-    else
-    {
-        MoMALogger::error("MoMA::reset_X for other modes not implemented.");
+        if (ds == DeflationScheme::CCA)
+        {
+            X_working->reset();
+            Y_working->reset();
+        }
+        else if (ds == DeflationScheme::LDA)
+        {
+            X_working->reset();
+        }
+        else if (ds != DeflationScheme::PCA_Hotelling &&
+                 ds != DeflationScheme::PCA_Schur_complement &&
+                 ds != DeflationScheme::PCA_Projection)
+        {
+            MoMALogger::error("MoMA::reset_X for other modes not implemented.");
+        }
+        // No matrix is ever rewritten
+        X_op.reset();
+        Xv_cache.clear();
+        Xtu_cache.clear();
+        is_gram_cached = false;
+        u_svd         = u_svd_original;
+        v_svd         = v_svd_original;
+        is_svd_cached = true;
+        is_deflated   = false;
     }
+    initialize_uv();
+    return 0;
 }
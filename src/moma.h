@@ -17,6 +17,12 @@
 // 4-D list
 #include "moma_fivedlist.h"
 
+// Truncated SVD
+#include "moma_lanczos.h"
+
+// Acceleration of the outer loop
+#include "moma_anderson.h"
+
 // Prototypes
 // moma_logging.cpp
 void moma_set_logger_level_cpp(int);
@@ -35,19 +41,76 @@ class MoMA
     double lambda_v;
     bool is_initialzied;  // only MoMA::initialze_uv() sets it to true
     bool is_solved;       // only MoMA::solve() sets it true.
-    arma::mat X;          // on X we perform the algorithm
+    bool is_deflated;     // only MoMA::deflate() sets it true, MoMA::reset_X() sets it false
+
+    // The matrix on which we find the pSVD, owned by MoMA. In PCA modes
+    // it is the data matrix X, dense or sparse; in CCA mode it is X^T Y,
+    // which is formed only if that makes matrix-vector products cheaper
+    // (see `form_cross_product` in `moma.cpp`); in LDA mode it is the
+    // p x K matrix X^T Y with Y the class indicator matrix.
+    std::unique_ptr<LinearOperator> X_base;
+
+    // MoMA::X_base minus the rank-1 corrections added by MoMA::deflate.
+    // All products with the (deflated) matrix go through MoMA::X_op,
+    // so that deflations never rewrite any matrix.
+    DeflatedOperator X_op;
 
-    arma::mat X_working;  // keep track of deflated matrices
-    arma::mat Y_working;
+    // CCA and LDA only: the data matrices (owned by MoMA) and their
+    // deflated versions. We do not need Y_working in LDA since Y is
+    // an indicator matrix.
+    std::unique_ptr<LinearOperator> X_data;
+    std::unique_ptr<LinearOperator> Y_data;
+    std::unique_ptr<DeflatedOperator> X_working;
+    std::unique_ptr<DeflatedOperator> Y_working;
+    ClassIndicator Y_indicator;  // LDA only
 
-    arma::mat X_original;  // const
-    arma::mat Y_original;
+    // Leading singular vectors of the current MoMA::X_op, valid if
+    // `is_svd_cached` is true, and those of the undeflated matrix.
+    // MoMA::X_base stays the same across grid points, so the SVD
+    // is computed once instead of once per grid point.
+    bool is_svd_cached;
+    arma::vec u_svd;
+    arma::vec v_svd;
+    arma::vec u_svd_original;
+    arma::vec v_svd_original;
 
     DeflationScheme ds;
 
-    // they are used in MoMA::evaluate_loss
-    arma::mat Omega_u;
-    arma::mat Omega_v;
+    // X_op * v and X_op^T * u for the last v and u seen, which are
+    // updated by the changes of v and u in MoMA::solve and
+    // MoMA::criterion_search. Cleared when MoMA::X_op changes.
+    ProductCache Xv_cache;
+    ProductCache Xtu_cache;
+
+    // Symmetric mode: X is a symmetric PSD matrix Sigma and u is tied to
+    // v, so the problem is a penalized eigenproblem on Sigma. Each outer
+    // iteration solves for v given Sigma v only, deflation is
+    // Sigma - d v v^T, and the u-side penalties are not used.
+    bool is_symmetric;
+
+    // Gram matrix fast path, see MoMA::use_gram. `gram` is the Gram
+    // matrix of MoMA::X_op, valid if `is_gram_cached` is true, and
+    // `gram_base` that of MoMA::X_base, formed once or given by the user.
+    bool is_u_unpenalized;  // P_u is "NONE"
+    long n_plain_iter;      // outer iterations in MoMA::solve outside the fast path
+    bool is_gram_cached;
+    arma::mat gram_base;
+    arma::mat gram;
+
+    // Whether MoMA::ds is one of the PCA deflation schemes
+    bool is_pca_mode() const;
+
+    // Whether the u-update is u = X v / ||X v||, so that the outer loop
+    // is a penalized power iteration on the Gram matrix X^T X, and each
+    // iteration costs O(p^2) instead of O(np). Only used in PCA modes, if
+    // the Gram matrix is given, or if X is dense, n >= MOMA_GRAM_RATIO * p
+    // and the outer iterations spent so far would have paid for forming
+    // X^T X, which costs about as much as p / 2 iterations on X. Then we
+    // spend at most twice the cost of the best choice in hindsight, and
+    // short runs keep the numerics of the plain iteration.
+    bool use_gram(double i_alpha_u) const;
+    // X^T (X v / ||X v||) = G v / sqrt(v^T G v), where G = X^T X
+    arma::vec gram_y_v(const arma::vec &v);
 
   public:
     // Receiver a grid of parameters
@@ -61,9 +124,20 @@ class MoMA
     // user-specified precisions
     int MAX_ITER;
     double EPS;
+    // precision of the PR problems at convergence, see MoMA::solve
+    double EPS_inner;
+    // precision of the truncated SVD used in MoMA::initialize_uv
+    double EPS_init;
     // Results -- will be modified during iterations and copied back to R
     arma::vec u;
     arma::vec v;
+    // Whether MoMA::solve extrapolates the outer iterates by Anderson
+    // acceleration
+    bool outer_acceleration;
+    // number of outer iterations, and total number of iterations taken by
+    // solver_u and solver_v, in the last call of MoMA::solve
+    int n_outer_iter;
+    long n_inner_iter;
 
     PR_solver solver_u;
     PR_solver solver_v;
@@ -73,37 +147,42 @@ class MoMA
     //
     // TODO: Decouple problem defintion and algorithmic choices
     //
-    MoMA(const arma::mat &X_,  // Pass X_ as a reference to avoid copy
-         /*
-          * sparsity - enforced through penalties
-          */
-         double i_lambda_u,  // regularization level
-         double i_lambda_v,
-         Rcpp::List i_prox_arg_list_u,
-         Rcpp::List i_prox_arg_list_v,
-
-         /*
-          * smoothness - enforced through constraints
-          */
-         double i_alpha_u,  // Smoothing levels
-         double i_alpha_v,
-         const arma::mat &i_Omega_u,  // Smoothing matrices
-         const arma::mat &i_Omega_v,
-
-         /*
-          * Algorithm parameters:
-          */
-         double i_EPS,
-         long i_MAX_ITER,
-         double i_EPS_inner,
-         long i_MAX_ITER_inner,
-         std::string i_solver,
-         DeflationScheme i_ds = DeflationScheme::PCA_Hotelling);
+    // PCA. MoMA takes the ownership of X_, see `new_data_operator` in
+    // `moma_expose.cpp` for how it is made from an R matrix. If
+    // `i_symmetric` is true, X_ is a symmetric positive semi-definite
+    // matrix, e.g., a covariance matrix, see MoMA::is_symmetric.
+    MoMA(std::unique_ptr<LinearOperator> X_,
+        /*
+         * sparsity - enforced through penalties
+         */
+        double i_lambda_u,  // regularization level
+        double i_lambda_v,
+        Rcpp::List i_prox_arg_list_u,
+        Rcpp::List i_prox_arg_list_v,
 
-    MoMA(
-        // Pass X_ as a reference to avoid copy
-        const arma::mat &X_working,
-        const arma::mat &Y_working,
+        /*
+         * smoothness - enforced through constraints
+         */
+        double i_alpha_u,  // Smoothing levels
+        double i_alpha_v,
+        const arma::sp_mat &i_Omega_u,  // Smoothing matrices
+        const arma::sp_mat &i_Omega_v,
+
+        /*
+         * Algorithm parameters:
+         */
+        double i_EPS,
+        long i_MAX_ITER,
+        double i_EPS_inner,
+        long i_MAX_ITER_inner,
+        double i_EPS_init,
+        std::string i_solver,
+        DeflationScheme i_ds = DeflationScheme::PCA_Hotelling,
+        bool i_symmetric     = false);
+
+    // CCA. MoMA takes the ownership of X_ and Y_.
+    MoMA(std::unique_ptr<LinearOperator> X_,
+        std::unique_ptr<LinearOperator> Y_,
         /*
          * sparsity - enforced through penalties
          */
@@ -117,8 +196,8 @@ class MoMA
          */
         double i_alpha_u,  // Smoothing levels
         double i_alpha_v,
-        const arma::mat &i_Omega_u,  // Smoothing matrices
-        const arma::mat &i_Omega_v,
+        const arma::sp_mat &i_Omega_u,  // Smoothing matrices
+        const arma::sp_mat &i_Omega_v,
 
         /*
          * Algorithm parameters:
@@ -127,9 +206,51 @@ class MoMA
         long i_MAX_ITER,
         double i_EPS_inner,
         long i_MAX_ITER_inner,
+        double i_EPS_init,
         std::string i_solver,
         DeflationScheme i_ds);
 
+    // LDA, where Y is the class indicator matrix
+    MoMA(
+        // Pass X_ as a reference to avoid copy
+        const arma::mat &X_,
+        ClassIndicator Y,  // class indicator matrix, scaled by 1 / sqrt(n)
+        /*
+         * sparsity - enforced through penalties
+         */
+        double i_lambda_u,  // regularization level
+        double i_lambda_v,
+        Rcpp::List i_prox_arg_list_u,
+        Rcpp::List i_prox_arg_list_v,
+
+        /*
+         * smoothness - enforced through constraints
+         */
+        double i_alpha_u,  // Smoothing levels
+        double i_alpha_v,
+        const arma::sp_mat &i_Omega_u,  // Smoothing matrices
+        const arma::sp_mat &i_Omega_v,
+
+        /*
+         * Algorithm parameters:
+         */
+        double i_EPS,
+        long i_MAX_ITER,
+        double i_EPS_inner,
+        long i_MAX_ITER_inner,
+        double i_EPS_init,
+        std::string i_solver);
+
+    // X_op and the solvers refer to matrices owned by this object
+    MoMA(const MoMA &) = delete;
+    MoMA &operator=(const MoMA &) = delete;
+
+    // Use a precomputed Gram matrix in the Gram matrix fast path. G must
+    // be exactly X^T X for the undeflated MoMA::X_base, which is still
+    // needed for u = X v / ||X v||. Only the dimensions are checked here;
+    // see `error_if_not_gram_of` in `util.R` for the check on the R side.
+    void set_gram(const arma::mat &G);
+
     // solve sfpca by iteratively solving
     // penalized regressions
     void solve();
@@ -0,0 +1,71 @@
+// -*- mode: C++; c-indent-level: 4; c-basic-offset: 4; indent-tabs-mode: nil;
+// -*-
+#include "moma_anderson.h"
+
+AndersonAcceleration::AndersonAcceleration(int i_memory) : memory(i_memory)
+{
+    reset();
+}
+
+void AndersonAcceleration::reset()
+{
+    dF.reset();
+    dG.reset();
+    f_prev.reset();
+    g_prev.reset();
+    res_prev        = 0;
+    has_prev        = false;
+    is_extrapolated = false;
+    n_rejected      = 0;
+}
+
+arma::vec AndersonAcceleration::next(const arma::vec &x, const arma::vec &g)
+{
+    arma::vec f = g - x;
+    double res  = arma::norm(f);
+
+    if (is_extrapolated && res > res_prev)
+    {
+        // Reject x and take the plain step from the last accepted point
+        n_rejected++;
+        dF.reset();
+        dG.reset();
+        is_extrapolated = false;
+        MoMALogger::debug("Anderson acceleration: extrapolation rejected.");
+        return g_prev;
+    }
+
+    if (has_prev)
+    {
+        if ((int)dF.n_cols == memory)
+        {
+            dF.shed_col(0);
+            dG.shed_col(0);
+        }
+        dF.insert_cols(dF.n_cols, f - f_prev);
+        dG.insert_cols(dG.n_cols, g - g_prev);
+    }
+    f_prev   = f;
+    g_prev   = g;
+    res_prev = res;
+    has_prev = true;
+
+    if (dF.n_cols == 0)
+    {
+        is_extrapolated = false;
+        return g;
+    }
+
+    // gamma = argmin || f - dF gamma ||, by the (slightly regularized)
+    // normal equations, which are only memory x memory
+    arma::mat FtF = dF.t() * dF;
+    FtF.diag() += MOMA_ANDERSON_REGULARIZATION * (1 + arma::trace(FtF));
+    arma::vec gamma;
+    if (!arma::solve(gamma, FtF, arma::vec(dF.t() * f)))
+    {
+        is_extrapolated = false;
+        return g;
+    }
+    is_extrapolated = true;
+    return g - dG * gamma;
+}
@@ -0,0 +1,45 @@
+// -*- mode: C++; c-indent-level: 4; c-basic-offset: 4; indent-tabs-mode: nil;
+// -*-
+#ifndef MOMA_ANDERSON_H
+#define MOMA_ANDERSON_H 1
+
+#include "moma_base.h"
+#include "moma_logging.h"
+
+// Anderson acceleration (type II) of a fixed-point iteration x = T(x), see
+//   Walker, H. F., & Ni, P. (2011). Anderson acceleration for fixed-point
+//   iterations. SIAM Journal on Numerical Analysis.
+//
+// Given x_k and g_k = T(x_k), the next iterate is g_k - dG gamma, where
+// gamma fits the residual f_k = g_k - x_k by the differences dF of the
+// last `memory` residuals, and dG are the corresponding differences of g.
+//
+// Safeguard: if the residual at an extrapolated point is larger than the
+// residual at the point it was extrapolated from, the extrapolation is
+// rejected, and the iteration falls back to the plain step from that
+// point, with the history cleared.
+class AndersonAcceleration
+{
+  private:
+    int memory;
+    arma::mat dF;  // differences of residuals, one per column
+    arma::mat dG;  // differences of T(x)
+    arma::vec f_prev;
+    arma::vec g_prev;
+    double res_prev;  // || f_prev ||
+    bool has_prev;
+    bool is_extrapolated;  // whether the last iterate returned is extrapolated
+
+  public:
+    int n_rejected;  // number of rejected extrapolations
+
+    AndersonAcceleration(int i_memory = MOMA_ANDERSON_MEMORY);
+
+    // Forget the history, e.g., when the map T changes
+    void reset();
+
+    // The next iterate given x and g = T(x)
+    arma::vec next(const arma::vec &x, const arma::vec &g);
+};
+
+#endif
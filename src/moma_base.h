@@ -8,6 +8,7 @@
 #define MOMA_BASE_H 1
 
 #include <iostream>
+#include <memory>
 #include <sstream>
 
 // We only include RcppArmadillo.h which pulls Rcpp.h in for us
@@ -20,6 +21,57 @@ static constexpr double MOMA_INFTY                = std::numeric_limits<double>:
 static const arma::vec MOMA_EMPTY_GRID_OF_LENGTH1 = -arma::ones<arma::vec>(1);
 static const double MOMA_FLOATPOINT_EPS           = 1e-8;
 #define MOMA_FUSEDLASSODP_BUFFERSIZE 5000
+
+// Truncated SVD (see `moma_lanczos.h`) used to initialize u and v. Below
+// MOMA_LANCZOS_MIN_DIM we simply call a full SVD.
+#define MOMA_LANCZOS_MIN_DIM 100
+#define MOMA_LANCZOS_SUBSPACE 20
+#define MOMA_LANCZOS_MAX_RESTART 100
+#define MOMA_LANCZOS_SEED 20180507
+static const double MOMA_LANCZOS_EPS = 1e-10;
+
+// Backtracking in FISTA_BT (see `moma_solver.h`): the local Lipschitz
+// estimate is multiplied by MOMA_FISTA_BT_GROW on a rejected step and
+// by MOMA_FISTA_BT_SHRINK before every iteration.
+#define MOMA_FISTA_BT_GROW 2.0
+#define MOMA_FISTA_BT_SHRINK 0.5
+
+// SSNAL (see `moma_solver.h`): the penalty parameter sigma of the
+// augmented Lagrangian starts at 1 and grows by MOMA_SSNAL_SIGMA_GROW
+// after every multiplier update up to MOMA_SSNAL_SIGMA_MAX, beyond which
+// the Newton systems become ill-conditioned.
+#define MOMA_SSNAL_SIGMA_GROW 3.0
+#define MOMA_SSNAL_SIGMA_MAX 1e4
+#define MOMA_SSNAL_MAX_LINESEARCH 30
+
+// Inexact inner solves in MoMA::solve: the first PR problems are solved to
+// a precision of MOMA_INEXACT_EPS_INIT, which is then multiplied by
+// MOMA_INEXACT_EPS_SHRINK every outer iteration, and kept below
+// MOMA_INEXACT_EPS_RATIO times the outer tolerance, until it reaches EPS_inner.
+#define MOMA_INEXACT_EPS_INIT 1e-3
+#define MOMA_INEXACT_EPS_SHRINK 0.1
+#define MOMA_INEXACT_EPS_RATIO 0.1
+
+// Anderson acceleration of the outer loop (see `moma_anderson.h`): number
+// of past iterates used, and the ridge added to the least squares problem
+#define MOMA_ANDERSON_MEMORY 5
+#define MOMA_ANDERSON_REGULARIZATION 1e-10
+
+// Products of a matrix with a vector with at most MOMA_SPARSE_MATVEC_RATIO
+// of its entries nonzero only touch the columns (or rows) of the matrix
+// matching the nonzero entries (see `moma_operator.h`)
+#define MOMA_SPARSE_MATVEC_RATIO 0.2
+
+// A cached product (see `ProductCache` in `moma_operator.h`) is updated
+// by at most MOMA_PRODUCT_CACHE_REFRESH deltas before being recomputed,
+// which bounds the accumulated rounding errors
+#define MOMA_PRODUCT_CACHE_REFRESH 50
+
+// The Gram matrix fast path (see MoMA::use_gram) forms X^T X itself only
+// if n >= MOMA_GRAM_RATIO * p, where an iteration on X^T X (p^2 flops)
+// is at least 2 * MOMA_GRAM_RATIO times cheaper than one on X (2np flops)
+#define MOMA_GRAM_RATIO 2
+
 enum class DeflationScheme
 {
     PCA_Hotelling        = 1,
@@ -5,13 +5,51 @@
 // 2. MoMA::grid_search (see function `cpp_moma_grid_search`)
 // 3. MoMA::criterion_search (see function `cpp_moma_criterion_search`)
 
+// Wrap a data matrix from R. A "dgCMatrix" stays sparse, and its
+// "scaled:center" and "scaled:scale" attributes (see `scale_data_matrix`
+// in `util.R`) are applied implicitly.
+std::unique_ptr<LinearOperator> new_data_operator(SEXP X)
+{
+    if (Rf_isS4(X) && Rf_inherits(X, "dgCMatrix"))
+    {
+        SEXP center = Rf_getAttrib(X, Rf_install("scaled:center"));
+        SEXP scale  = Rf_getAttrib(X, Rf_install("scaled:scale"));
+        return std::unique_ptr<LinearOperator>(new SparseOperator(
+            Rcpp::as<arma::sp_mat>(X),
+            Rf_isNull(center) ? arma::vec() : Rcpp::as<arma::vec>(center),
+            Rf_isNull(scale) ? arma::vec() : Rcpp::as<arma::vec>(scale)));
+    }
+    if (Rf_isMatrix(X) && Rf_isReal(X))
+    {
+        // no copy of the data
+        return std::unique_ptr<LinearOperator>(
+            new DenseOperator(REAL(X), Rf_nrows(X), Rf_ncols(X)));
+    }
+    return std::unique_ptr<LinearOperator>(new DenseOperator(Rcpp::as<arma::mat>(X)));
+}
+
+// Smoothing matrices are stored as sparse matrices in C++. A dense
+// matrix from R is converted by scanning its entries in place.
+arma::sp_mat as_smoothing_matrix(SEXP Omega)
+{
+    if (Rf_isS4(Omega))
+    {
+        return Rcpp::as<arma::sp_mat>(Omega);
+    }
+    if (Rf_isMatrix(Omega) && Rf_isReal(Omega))
+    {
+        return arma::sp_mat(arma::mat(REAL(Omega), Rf_nrows(Omega), Rf_ncols(Omega), false, true));
+    }
+    return arma::sp_mat(Rcpp::as<arma::mat>(Omega));
+}
+
 // [[Rcpp::export]]
 Rcpp::List cpp_moma_multi_rank(
-    const arma::mat &X,  // We should not change any variable in R, so const ref
+    SEXP X,  // dense or sparse ("dgCMatrix"), see `new_data_operator`
     const arma::vec &alpha_u,
     const arma::vec &alpha_v,
-    const arma::mat &Omega_u,  // Default values for these matrices should be set in R
-    const arma::mat &Omega_v,
+    SEXP Omega_u,  // Default values for these matrices should be set in R
+    SEXP Omega_v,  // dense or sparse, see `as_smoothing_matrix`
     const arma::vec &lambda_u,
     const arma::vec &lambda_v,
     const Rcpp::List &prox_arg_list_u,
@@ -20,18 +58,28 @@ Rcpp::List cpp_moma_multi_rank(
     long MAX_ITER,
     double EPS_inner,
     long MAX_ITER_inner,
+    double EPS_init,  // precision of the initial SVD, see `MoMA::EPS_init`
     std::string solver,
-    int rank = 1)
+    bool outer_acceleration,
+    int rank       = 1,
+    SEXP gram      = R_NilValue,  // X^T X, see `MoMA::set_gram`
+    bool symmetric = false)       // X is symmetric PSD, see `MoMA::is_symmetric`
 {
     // WARNING: arguments should be listed
     // in the exact order of MoMA constructor
-    MoMA problem(X,
+    MoMA problem(new_data_operator(X),
                  /* sparsity */
                  lambda_u(0), lambda_v(0), prox_arg_list_u, prox_arg_list_v,
                  /* smoothness */
-                 alpha_u(0), alpha_v(0), Omega_u, Omega_v,
+                 alpha_u(0), alpha_v(0), as_smoothing_matrix(Omega_u), as_smoothing_matrix(Omega_v),
                  /* algorithm parameters */
-                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, solver);
+                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, EPS_init, solver,
+                 DeflationScheme::PCA_Hotelling, symmetric);
+    problem.outer_acceleration = outer_acceleration;
+    if (!Rf_isNull(gram))
+    {
+        problem.set_gram(Rcpp::as<arma::mat>(gram));
+    }
 
     int n_lambda_u = lambda_u.n_elem;
     int n_lambda_v = lambda_v.n_elem;
@@ -50,11 +98,11 @@ Rcpp::List cpp_moma_multi_rank(
 // This function solves a squence of lambda's and alpha's
 // [[Rcpp::export]]
 Rcpp::List cpp_moma_grid_search(
-    const arma::mat &X,  // We should not change any variable in R, so const ref
+    SEXP X,  // dense or sparse ("dgCMatrix"), see `new_data_operator`
     const arma::vec &alpha_u,
     const arma::vec &alpha_v,
-    const arma::mat &Omega_u,  // Default values for these matrices should be set in R
-    const arma::mat &Omega_v,
+    SEXP Omega_u,  // Default values for these matrices should be set in R
+    SEXP Omega_v,  // dense or sparse, see `as_smoothing_matrix`
     const arma::vec &lambda_u,
     const arma::vec &lambda_v,
     const Rcpp::List &prox_arg_list_u,
@@ -63,8 +111,12 @@ Rcpp::List cpp_moma_grid_search(
     long MAX_ITER,
     double EPS_inner,
     long MAX_ITER_inner,
+    double EPS_init,  // precision of the initial SVD, see `MoMA::EPS_init`
     std::string solver,
-    int rank = 1)  // `rank` is not used
+    bool outer_acceleration,
+    int rank       = 1,           // `rank` is not used
+    SEXP gram      = R_NilValue,  // X^T X, see `MoMA::set_gram`
+    bool symmetric = false)       // X is symmetric PSD, see `MoMA::is_symmetric`
 {
     if (rank != 1)
     {
@@ -90,13 +142,19 @@ Rcpp::List cpp_moma_grid_search(
 
     // NOTE: arguments should be listed
     // in the exact order of MoMA constructor
-    MoMA problem(X,
+    MoMA problem(new_data_operator(X),
                  /* sparsity */
                  lambda_u(0), lambda_v(0), prox_arg_list_u, prox_arg_list_v,
                  /* smoothness */
-                 alpha_u(0), alpha_v(0), Omega_u, Omega_v,
+                 alpha_u(0), alpha_v(0), as_smoothing_matrix(Omega_u), as_smoothing_matrix(Omega_v),
                  /* algorithm parameters */
-                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, solver);
+                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, EPS_init, solver,
+                 DeflationScheme::PCA_Hotelling, symmetric);
+    problem.outer_acceleration = outer_acceleration;
+    if (!Rf_isNull(gram))
+    {
+        problem.set_gram(Rcpp::as<arma::mat>(gram));
+    }
 
     // store results
     return problem.grid_search(alpha_u, lambda_u, alpha_v, lambda_v, problem.u, problem.v);
@@ -105,11 +163,11 @@ Rcpp::List cpp_moma_grid_search(
 // This function solves a squence of lambda's and alpha's
 // [[Rcpp::export]]
 Rcpp::List cpp_moma_criterion_search(
-    const arma::mat &X,  // We should not change any variable in R, so const ref
+    SEXP X,  // dense or sparse ("dgCMatrix"), see `new_data_operator`
     const arma::vec &alpha_u,
     const arma::vec &alpha_v,
-    const arma::mat &Omega_u,  // Default values for these matrices should be set in R
-    const arma::mat &Omega_v,
+    SEXP Omega_u,  // Default values for these matrices should be set in R
+    SEXP Omega_v,  // dense or sparse, see `as_smoothing_matrix`
     const arma::vec &lambda_u,
     const arma::vec &lambda_v,
     const Rcpp::List &prox_arg_list_u,
@@ -118,8 +176,12 @@ Rcpp::List cpp_moma_criterion_search(
     long MAX_ITER,
     double EPS_inner,
     long MAX_ITER_inner,
+    double EPS_init,  // precision of the initial SVD, see `MoMA::EPS_init`
     std::string solver,
-    int rank = 1)  // rank not used
+    bool outer_acceleration,
+    int rank       = 1,           // rank not used
+    SEXP gram      = R_NilValue,  // X^T X, see `MoMA::set_gram`
+    bool symmetric = false)       // X is symmetric PSD, see `MoMA::is_symmetric`
 {
     if (rank != 1)
     {
@@ -145,13 +207,19 @@ Rcpp::List cpp_moma_criterion_search(
 
     // NOTE: arguments should be listed
     // in the exact order of MoMA constructor
-    MoMA problem(X,
+    MoMA problem(new_data_operator(X),
                  /* sparsity */
                  lambda_u(0), lambda_v(0), prox_arg_list_u, prox_arg_list_v,
                  /* smoothness */
-                 alpha_u(0), alpha_v(0), Omega_u, Omega_v,
+                 alpha_u(0), alpha_v(0), as_smoothing_matrix(Omega_u), as_smoothing_matrix(Omega_v),
                  /* algorithm parameters */
-                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, solver);
+                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, EPS_init, solver,
+                 DeflationScheme::PCA_Hotelling, symmetric);
+    problem.outer_acceleration = outer_acceleration;
+    if (!Rf_isNull(gram))
+    {
+        problem.set_gram(Rcpp::as<arma::mat>(gram));
+    }
 
     return problem.criterion_search(alpha_u, lambda_u, alpha_v, lambda_v, problem.u, problem.v,
                                     EPS);
@@ -160,11 +228,11 @@ Rcpp::List cpp_moma_criterion_search(
 // This function solves a squence of lambda's and alpha's
 // [[Rcpp::export]]
 Rcpp::List cpp_multirank_BIC_grid_search(
-    const arma::mat &X,  // We should not change any variable in R, so const ref
+    SEXP X,  // dense or sparse ("dgCMatrix"), see `new_data_operator`
     const arma::vec &alpha_u,
     const arma::vec &alpha_v,
-    const arma::mat &Omega_u,  // Default values for these matrices should be set in R
-    const arma::mat &Omega_v,
+    SEXP Omega_u,  // Default values for these matrices should be set in R
+    SEXP Omega_v,  // dense or sparse, see `as_smoothing_matrix`
     const arma::vec &lambda_u,
     const arma::vec &lambda_v,
     const Rcpp::List &prox_arg_list_u,
@@ -173,14 +241,18 @@ Rcpp::List cpp_multirank_BIC_grid_search(
     long MAX_ITER,
     double EPS_inner,
     long MAX_ITER_inner,
+    double EPS_init,  // precision of the initial SVD, see `MoMA::EPS_init`
     std::string solver,
+    bool outer_acceleration,
     int deflation_scheme       = 1,  // Defaults to 1 = PCA_Hotelling
     int select_scheme_alpha_u  = 0,  // 0 means grid, 1 means BIC search
     int select_scheme_alpha_v  = 0,
     int select_scheme_lambda_u = 0,
     int select_scheme_lambda_v = 0,
     int max_bic_iter           = 5,
-    int rank                   = 1)
+    int rank                   = 1,
+    SEXP gram                  = R_NilValue,  // X^T X, see `MoMA::set_gram`
+    bool symmetric             = false)       // X is symmetric PSD, see `MoMA::is_symmetric`
 {
     int n_lambda_u = lambda_u.n_elem;
     int n_lambda_v = lambda_v.n_elem;
@@ -194,14 +266,19 @@ Rcpp::List cpp_multirank_BIC_grid_search(
 
     // NOTE: arguments should be listed
     // in the exact order of MoMA constructor
-    MoMA problem(X,
+    MoMA problem(new_data_operator(X),
                  /* sparsity */
                  lambda_u(0), lambda_v(0), prox_arg_list_u, prox_arg_list_v,
                  /* smoothness */
-                 alpha_u(0), alpha_v(0), Omega_u, Omega_v,
+                 alpha_u(0), alpha_v(0), as_smoothing_matrix(Omega_u), as_smoothing_matrix(Omega_v),
                  /* algorithm parameters */
-                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, solver,
-                 static_cast<DeflationScheme>(deflation_scheme));
+                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, EPS_init, solver,
+                 static_cast<DeflationScheme>(deflation_scheme), symmetric);
+    problem.outer_acceleration = outer_acceleration;
+    if (!Rf_isNull(gram))
+    {
+        problem.set_gram(Rcpp::as<arma::mat>(gram));
+    }
 
     return problem.grid_BIC_mix(alpha_u, alpha_v, lambda_u, lambda_v, select_scheme_alpha_u,
                                 select_scheme_alpha_v, select_scheme_lambda_u,
@@ -209,12 +286,12 @@ Rcpp::List cpp_multirank_BIC_grid_search(
 }
 
 // [[Rcpp::export]]
-Rcpp::List cca(const arma::mat &X,  // We should not change any variable in R, so const ref
-               const arma::mat &Y,
+Rcpp::List cca(SEXP X,  // dense or sparse ("dgCMatrix"), see `new_data_operator`
+               SEXP Y,
                const arma::vec &alpha_u,
                const arma::vec &alpha_v,
-               const arma::mat &Omega_u,  // Default values for these matrices should be set in R
-               const arma::mat &Omega_v,
+               SEXP Omega_u,  // Default values for these matrices should be set in R
+               SEXP Omega_v,  // dense or sparse, see `as_smoothing_matrix`
                const arma::vec &lambda_u,
                const arma::vec &lambda_v,
                const Rcpp::List &prox_arg_list_u,
@@ -223,7 +300,9 @@ Rcpp::List cca(const arma::mat &X,  // We should not change any variable in R, s
                long MAX_ITER,
                double EPS_inner,
                long MAX_ITER_inner,
+               double EPS_init,
                std::string solver,
+               bool outer_acceleration,
                int deflation_scheme,            // PCA = 1, CCA = 2, LDA = 3, PLS = 4
                int select_scheme_alpha_u  = 0,  // 0 means grid, 1 means BIC search
                int select_scheme_alpha_v  = 0,
@@ -244,14 +323,68 @@ Rcpp::List cca(const arma::mat &X,  // We should not change any variable in R, s
 
     // NOTE: arguments should be listed
     // in the exact order of MoMA constructor
-    MoMA problem(X, Y,
+    MoMA problem(new_data_operator(X), new_data_operator(Y),
                  /* sparsity */
                  lambda_u(0), lambda_v(0), prox_arg_list_u, prox_arg_list_v,
                  /* smoothness */
-                 alpha_u(0), alpha_v(0), Omega_u, Omega_v,
+                 alpha_u(0), alpha_v(0), as_smoothing_matrix(Omega_u), as_smoothing_matrix(Omega_v),
                  /* algorithm parameters */
-                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, solver,
+                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, EPS_init, solver,
                  static_cast<DeflationScheme>(deflation_scheme));
+    problem.outer_acceleration = outer_acceleration;
+
+    return problem.grid_BIC_mix(alpha_u, alpha_v, lambda_u, lambda_v, select_scheme_alpha_u,
+                                select_scheme_alpha_v, select_scheme_lambda_u,
+                                select_scheme_lambda_v, max_bic_iter, rank);
+}
+
+// [[Rcpp::export]]
+Rcpp::List lda(const arma::mat &X,  // We should not change any variable in R, so const ref
+               const arma::uvec &Y_label,  // 0-based class labels
+               int n_class,
+               const arma::vec &alpha_u,
+               const arma::vec &alpha_v,
+               SEXP Omega_u,  // Default values for these matrices should be set in R
+               SEXP Omega_v,  // dense or sparse, see `as_smoothing_matrix`
+               const arma::vec &lambda_u,
+               const arma::vec &lambda_v,
+               const Rcpp::List &prox_arg_list_u,
+               const Rcpp::List &prox_arg_list_v,
+               double EPS,
+               long MAX_ITER,
+               double EPS_inner,
+               long MAX_ITER_inner,
+               double EPS_init,
+               std::string solver,
+               bool outer_acceleration,
+               int select_scheme_alpha_u  = 0,  // 0 means grid, 1 means BIC search
+               int select_scheme_alpha_v  = 0,
+               int select_scheme_lambda_u = 0,
+               int select_scheme_lambda_v = 0,
+               int max_bic_iter           = 5,
+               int rank                   = 1)
+{
+    int n_lambda_u = lambda_u.n_elem;
+    int n_lambda_v = lambda_v.n_elem;
+    int n_alpha_u  = alpha_u.n_elem;
+    int n_alpha_v  = alpha_v.n_elem;
+
+    if (n_lambda_v == 0 || n_lambda_u == 0 || n_alpha_u == 0 || n_alpha_v == 0)
+    {
+        MoMALogger::error("Please specify all four parameters.");
+    }
+
+    // NOTE: arguments should be listed
+    // in the exact order of MoMA constructor.
+    // Y = model.matrix(~ Y_factor - 1) / sqrt(n) in R
+    MoMA problem(X, ClassIndicator(Y_label, n_class, 1 / std::sqrt((double)X.n_rows)),
+                 /* sparsity */
+                 lambda_u(0), lambda_v(0), prox_arg_list_u, prox_arg_list_v,
+                 /* smoothness */
+                 alpha_u(0), alpha_v(0), as_smoothing_matrix(Omega_u), as_smoothing_matrix(Omega_v),
+                 /* algorithm parameters */
+                 EPS, MAX_ITER, EPS_inner, MAX_ITER_inner, EPS_init, solver);
+    problem.outer_acceleration = outer_acceleration;
 
     return problem.grid_BIC_mix(alpha_u, alpha_v, lambda_u, lambda_v, select_scheme_alpha_u,
                                 select_scheme_alpha_v, select_scheme_lambda_u,
@@ -0,0 +1,230 @@
+// -*- mode: C++; c-indent-level: 4; c-basic-offset: 4; indent-tabs-mode: nil;
+// -*-
+#include "moma_lanczos.h"
+
+// A deterministic "random" unit vector, generated by a linear
+// congruential generator with a fixed seed
+arma::vec lanczos_start_vector(int dim)
+{
+    arma::vec x(dim);
+    uint32_t state = MOMA_LANCZOS_SEED;
+    for (int i = 0; i < dim; i++)
+    {
+        state = 1664525u * state + 1013904223u;
+        x(i)  = state / 4294967296.0 - 0.5;
+    }
+    return x / arma::norm(x);
+}
+
+// Remove from `x` its components in the column space of `Q`, whose
+// columns are orthonormal. Classical Gram-Schmidt is applied twice
+// to keep the basis orthogonal to working precision.
+void reorthogonalize(arma::vec &x, const arma::mat &Q)
+{
+    for (int pass = 0; pass < 2; pass++)
+    {
+        x -= Q * (Q.t() * x);
+    }
+}
+
+int leading_singular_triplet(const LinearOperator &A,
+                             arma::vec &u,
+                             arma::vec &v,
+                             double &d,
+                             double tol,
+                             int max_restart)
+{
+    int n = A.n_rows();
+    int p = A.n_cols();
+    int k = std::min(MOMA_LANCZOS_SUBSPACE, std::min(n, p));
+
+    arma::mat U(n, k);
+    arma::mat V(p, k);
+    arma::vec alpha(k);  // diagonal of the bidiagonal matrix B = U^T A V
+    arma::vec beta(k);   // super-diagonal of B
+
+    arma::vec v_start = lanczos_start_vector(p);
+
+    double residual = MOMA_INFTY;
+    int restart     = 0;
+    for (; restart < max_restart; restart++)
+    {
+        // mu and mv are the number of left and right Lanczos
+        // vectors we have found in this cycle
+        int mu         = 0;
+        int mv         = 1;
+        bool invariant = false;
+        double scale   = 0;  // estimate of ||A||, used to detect breakdown
+        V.col(0)       = v_start;
+
+        for (int j = 0; j < k; j++)
+        {
+            arma::vec r = A.times(V.col(j));
+            if (j > 0)
+            {
+                reorthogonalize(r, U.cols(0, j - 1));
+            }
+            alpha(j) = arma::norm(r);
+            scale    = std::max(scale, alpha(j));
+            if (alpha(j) <= std::numeric_limits<double>::epsilon() * scale)
+            {
+                // A maps span(V) into span(U): the subspaces are invariant
+                invariant = true;
+                break;
+            }
+            U.col(j) = r / alpha(j);
+            mu       = j + 1;
+
+            arma::vec s = A.trans_times(U.col(j));
+            reorthogonalize(s, V.cols(0, j));
+            beta(j) = arma::norm(s);
+            scale   = std::max(scale, beta(j));
+            if (beta(j) <= std::numeric_limits<double>::epsilon() * scale)
+            {
+                invariant = true;
+                break;
+            }
+            if (j + 1 < k)
+            {
+                V.col(j + 1) = s / beta(j);
+                mv           = j + 2;
+            }
+        }
+
+        if (mu == 0)
+        {
+            // A * v_start = 0. This happens only if A is a zero matrix
+            // (or v_start happens to lie in its null space).
+            MoMALogger::debug("Lanczos bidiagonalization: zero matrix encountered.");
+            d = 0;
+            u = lanczos_start_vector(n);
+            v = v_start;
+            return 0;
+        }
+
+        // B is an upper bidiagonal matrix, of size mu x mu, or
+        // mu x (mu + 1) if the process stops at an alpha breakdown
+        arma::mat B(mu, mv, arma::fill::zeros);
+        for (int i = 0; i < mu; i++)
+        {
+            B(i, i) = alpha(i);
+            if (i + 1 < mv)
+            {
+                B(i, i + 1) = beta(i);
+            }
+        }
+
+        arma::mat P;
+        arma::vec sigma;
+        arma::mat Q;
+        arma::svd(P, sigma, Q, B);
+
+        d = sigma(0);
+        u = U.cols(0, mu - 1) * P.col(0);
+        v = V.cols(0, mv - 1) * Q.col(0);
+
+        // A v = d u holds exactly, and
+        // || A^T u - d v || = beta_k * | last element of the left Ritz vector |
+        residual = invariant ? 0.0 : beta(k - 1) * std::abs(P(mu - 1, 0));
+        MoMALogger::debug("Lanczos bidiagonalization: (restart, d, residual) = (")
+            << restart << ", " << d << ", " << residual << ")";
+        if (residual <= tol * d)
+        {
+            break;
+        }
+        v_start = v / arma::norm(v);
+    }
+
+    if (residual > tol * d)
+    {
+        MoMALogger::warning("No convergence in truncated SVD: residual = ")
+            << residual << ", singular value = " << d;
+        return 1;
+    }
+    MoMALogger::debug("Finish truncated SVD. Total restarts = ") << restart;
+    return 0;
+}
+
+int leading_eigenpair(const LinearOperator &A,
+                      arma::vec &v,
+                      double &d,
+                      double tol,
+                      int max_restart)
+{
+    int p = A.n_cols();
+    int k = std::min(MOMA_LANCZOS_SUBSPACE, p);
+
+    arma::mat V(p, k);
+    arma::vec alpha(k);  // diagonal of the tridiagonal matrix T = V^T A V
+    arma::vec beta(k);   // off-diagonal of T
+
+    arma::vec v_start = lanczos_start_vector(p);
+
+    double residual = MOMA_INFTY;
+    int restart     = 0;
+    for (; restart < max_restart; restart++)
+    {
+        // m is the number of Lanczos vectors we have found in this cycle
+        int m          = 0;
+        bool invariant = false;
+        double scale   = 0;  // estimate of ||A||, used to detect breakdown
+        V.col(0)       = v_start;
+
+        for (int j = 0; j < k; j++)
+        {
+            m           = j + 1;
+            arma::vec r = A.times(V.col(j));
+            alpha(j)    = arma::dot(V.col(j), r);
+            reorthogonalize(r, V.cols(0, j));
+            beta(j) = arma::norm(r);
+            scale   = std::max(scale, std::max(std::abs(alpha(j)), beta(j)));
+            if (beta(j) <= std::numeric_limits<double>::epsilon() * scale)
+            {
+                // span(V) is invariant under A
+                invariant = true;
+                break;
+            }
+            if (j + 1 < k)
+            {
+                V.col(j + 1) = r / beta(j);
+            }
+        }
+
+        arma::mat T(m, m, arma::fill::zeros);
+        for (int i = 0; i < m; i++)
+        {
+            T(i, i) = alpha(i);
+            if (i + 1 < m)
+            {
+                T(i, i + 1) = beta(i);
+                T(i + 1, i) = beta(i);
+            }
+        }
+
+        arma::vec theta;
+        arma::mat Q;
+        arma::eig_sym(theta, Q, T);  // eigenvalues in ascending order
+
+        d = theta(m - 1);
+        v = V.cols(0, m - 1) * Q.col(m - 1);
+
+        // || A v - d v || = beta_m * | last element of the Ritz vector |
+        residual = invariant ? 0.0 : beta(m - 1) * std::abs(Q(m - 1, m - 1));
+        MoMALogger::debug("Symmetric Lanczos: (restart, d, residual) = (")
+            << restart << ", " << d << ", " << residual << ")";
+        if (residual <= tol * std::abs(d))
+        {
+            break;
+        }
+        v_start = v / arma::norm(v);
+    }
+
+    if (residual > tol * std::abs(d))
+    {
+        MoMALogger::warning("No convergence in symmetric Lanczos: residual = ")
+            << residual << ", eigenvalue = " << d;
+        return 1;
+    }
+    MoMALogger::debug("Finish symmetric Lanczos. Total restarts = ") << restart;
+    return 0;
+}
@@ -0,0 +1,46 @@
+// -*- mode: C++; c-indent-level: 4; c-basic-offset: 4; indent-tabs-mode: nil;
+// -*-
+#ifndef MOMA_LANCZOS_H
+#define MOMA_LANCZOS_H 1
+
+#include "moma_base.h"
+#include "moma_logging.h"
+#include "moma_operator.h"
+
+// Find the leading singular triplet (d, u, v) of A, i.e., A v = d u and
+// A^T u = d v with d the largest singular value.
+//
+// We use Golub-Kahan-Lanczos bidiagonalization with full re-orthogonalization,
+// restarted from the current leading Ritz vector until
+// || A^T u - d v || <= tol * d. Only the products A * v and A^T * u are used,
+// so the cost is O(nnz(A) * MOMA_LANCZOS_SUBSPACE) per restart instead of
+// the O(n p min(n, p)) of a full SVD.
+//
+// The start vector is generated from a fixed seed, so results are reproducible
+// and do not touch R's random number generator.
+//
+// Returns 0 if the triplet converged and 1 otherwise.
+int leading_singular_triplet(const LinearOperator &A,
+                             arma::vec &u,
+                             arma::vec &v,
+                             double &d,
+                             double tol      = MOMA_LANCZOS_EPS,
+                             int max_restart = MOMA_LANCZOS_MAX_RESTART);
+
+// Find the leading eigenpair (d, v) of a symmetric A, i.e., A v = d v with
+// d the largest eigenvalue, which is the leading singular value if A is
+// positive semi-definite.
+//
+// We use symmetric Lanczos with full re-orthogonalization, restarted from the
+// current leading Ritz vector until || A v - d v || <= tol * |d|. Compared
+// with `leading_singular_triplet`, each Lanczos step takes one product
+// instead of two.
+//
+// Returns 0 if the pair converged and 1 otherwise.
+int leading_eigenpair(const LinearOperator &A,
+                      arma::vec &v,
+                      double &d,
+                      double tol      = MOMA_LANCZOS_EPS,
+                      int max_restart = MOMA_LANCZOS_MAX_RESTART);
+
+#endif
@@ -15,6 +15,18 @@ const arma::vec &construct_grid_for_search(const arma::vec &grid, int want_grid)
     }
 }
 
+// The (deflated) data matrix returned to R. Sparse matrices are
+// never densified: the deflated matrix is dense in general, so
+// we return NULL instead.
+SEXP wrap_data_matrix(const LinearOperator &X)
+{
+    if (X.is_sparse())
+    {
+        return R_NilValue;
+    }
+    return Rcpp::wrap(X.dense());
+}
+
 arma::vec construct_grid_no_search(const arma::vec &grid, int want_bic, int i)
 {
     if (want_bic == 1)
@@ -74,24 +86,50 @@ Rcpp::List MoMA::criterion_search(const arma::vec &bic_au_grid,
     arma::vec curu = initial_u;
     arma::vec curv = initial_v;
 
+    // In the Gram matrix fast path (see MoMA::use_gram), there is
+    // nothing to search for u, which is only formed after the loop.
+    // In symmetric mode, u is v.
+    bool is_gram = n_au == 1 && n_lu == 1 && use_gram(bic_au_grid(0));
+    bool skip_u  = is_gram || is_symmetric;
+
     // We conduct 2 BIC searches over 2D grids here instead
     // of 4 searches over 1D grids. It's consistent with
     // Genevera's code.
     if (n_au > 1 || n_av > 1 || n_lu > 1 || n_lv > 1)
     {
+        if (skip_u)
+        {
+            u_result = Rcpp::List::create(
+                Rcpp::Named("lambda") = bic_lu_grid(0), Rcpp::Named("alpha") = bic_au_grid(0),
+                Rcpp::Named("vector") = initial_u, Rcpp::Named("bic") = -MOMA_INFTY);
+        }
         while (tol > EPS_bic && iter < max_bic_iter)
         {
             iter++;
             oldu = curu;
             oldv = curv;
 
-            // choose lambda/alpha_u
-            MoMALogger::debug("Start u search.");
-            u_result = bicsr_u.search(X * curv, curu, bic_au_grid, bic_lu_grid);
-            curu     = Rcpp::as<Rcpp::NumericVector>(u_result["vector"]);
+            arma::vec y_v;
+            if (is_symmetric)
+            {
+                y_v = Xv_cache.times(X_op, curv);
+            }
+            else if (is_gram)
+            {
+                y_v = gram_y_v(curv);
+            }
+            else
+            {
+                // choose lambda/alpha_u
+                MoMALogger::debug("Start u search.");
+                u_result =
+                    bicsr_u.search(Xv_cache.times(X_op, curv), curu, bic_au_grid, bic_lu_grid);
+                curu = Rcpp::as<Rcpp::NumericVector>(u_result["vector"]);
+                y_v  = Xtu_cache.times(X_op, curu);
+            }
 
             MoMALogger::debug("Start v search.");
-            v_result = bicsr_v.search(X.t() * curu, curv, bic_av_grid, bic_lv_grid);
+            v_result = bicsr_v.search(y_v, curv, bic_av_grid, bic_lv_grid);
             curv     = Rcpp::as<Rcpp::NumericVector>(v_result["vector"]);
 
             double scale_u = arma::norm(oldu) == 0.0 ? 1 : arma::norm(oldu);
@@ -103,6 +141,14 @@ Rcpp::List MoMA::criterion_search(const arma::vec &bic_au_grid,
                 << "(bic_u, bic_v) = (" << (double)u_result["bic"] << "," << (double)v_result["bic"]
                 << ")";
         }
+        if (is_symmetric)
+        {
+            u_result["vector"] = curv;
+        }
+        else if (is_gram)
+        {
+            u_result = bicsr_u.search(X_op.times(curv), curu, bic_au_grid, bic_lu_grid);
+        }
     }
     else
     {
@@ -149,7 +195,8 @@ Rcpp::List MoMA::criterion_search(const arma::vec &bic_au_grid,
 //     Rcpp::Named("bic") = minbic_u
 // Rcpp::Named("v") = v_result, same as "u"
 // Rcpp::Named("k") = pc, the pc-th SVs
-// Rcpp::Named("X"), the matrix with which we solve for u and v
+// Rcpp::Named("X"), the matrix with which we solve for u and v,
+//     NULL if the data matrix is sparse
 Rcpp::List MoMA::grid_BIC_mix(const arma::vec &alpha_u,
                               const arma::vec &alpha_v,
                               const arma::vec &lambda_u,
@@ -239,7 +286,7 @@ Rcpp::List MoMA::grid_BIC_mix(const arma::vec &alpha_u,
 
                         arma::vec curu = Rcpp::as<Rcpp::NumericVector>(u_result["vector"]);
                         arma::vec curv = Rcpp::as<Rcpp::NumericVector>(v_result["vector"]);
-                        double d       = arma::as_scalar(curu.t() * X * curv);
+                        double d       = X_op.bilinear(curu, curv);
 
                         Rcpp::List wrap_up;
                         if (ds == DeflationScheme::PCA_Hotelling ||
@@ -248,21 +295,25 @@ Rcpp::List MoMA::grid_BIC_mix(const arma::vec &alpha_u,
                         {
                             wrap_up = Rcpp::List::create(
                                 Rcpp::Named("u") = u_result, Rcpp::Named("v") = v_result,
-                                Rcpp::Named("k") = pc, Rcpp::Named("X") = X, Rcpp::Named("d") = d);
+                                Rcpp::Named("k") = pc, Rcpp::Named("X") = wrap_data_matrix(X_op),
+                                Rcpp::Named("d") = d);
                         }
                         else if (ds == DeflationScheme::CCA)
                         {
                             wrap_up = Rcpp::List::create(
                                 Rcpp::Named("u") = u_result, Rcpp::Named("v") = v_result,
-                                Rcpp::Named("k") = pc, Rcpp::Named("X") = X_working,
-                                Rcpp::Named("Y") = Y_working,  // an extra "Y" element
+                                Rcpp::Named("k") = pc,
+                                Rcpp::Named("X") = wrap_data_matrix(*X_working),
+                                // an extra "Y" element
+                                Rcpp::Named("Y") = wrap_data_matrix(*Y_working),
                                 Rcpp::Named("d") = d);
                         }
                         else if (ds == DeflationScheme::LDA)
                         {
                             wrap_up = Rcpp::List::create(
                                 Rcpp::Named("u") = u_result, Rcpp::Named("v") = v_result,
-                                Rcpp::Named("k") = pc, Rcpp::Named("X") = X_working,
+                                Rcpp::Named("k") = pc,
+                                Rcpp::Named("X") = wrap_data_matrix(*X_working),
                                 Rcpp::Named("d") = d);
                         }
                         else
@@ -293,7 +344,9 @@ Rcpp::List MoMA::grid_BIC_mix(const arma::vec &alpha_u,
 // Rcpp::Named("alpha_v") = alpha_v,
 // Rcpp::Named("u") = U,
 // Rcpp::Named("v") = V,
-// Rcpp::Named("d") = d
+// Rcpp::Named("d") = d,
+// Rcpp::Named("n_outer_iter"), the number of outer iterations spent on each PC
+// Rcpp::Named("n_inner_iter"), the number of inner iterations spent on each PC
 // 2. Dependence on MoMA's internal states: MoMA::X, MoMA::alpha_u/v, MoMA::lambda_u/v.
 // 3. After calling MoMA::multi_rank, MoMA: MoMA::X becomes the corresponding deflated matrix.
 // MoMA::u and MoMA::v become the leading penalized SVs of MoMA::X, using leading SVs of MoMA::X as
@@ -305,9 +358,11 @@ Rcpp::List MoMA::multi_rank(int rank, arma::vec initial_u, arma::vec initial_v)
         MoMALogger::error("MoMA::multirank received non-positive rank: k = ") << rank;
     }
     // store results
-    arma::mat U(X.n_rows, rank);
-    arma::mat V(X.n_cols, rank);
+    arma::mat U(X_op.n_rows(), rank);
+    arma::mat V(X_op.n_cols(), rank);
     arma::vec d(rank);
+    arma::vec outer_iter(rank);
+    arma::vec inner_iter(rank);
 
     u = initial_u;
     v = initial_v;
@@ -317,9 +372,11 @@ Rcpp::List MoMA::multi_rank(int rank, arma::vec initial_u, arma::vec initial_v)
     {
         // Use MoMA::u and MoMA::v as start points.
         solve();
-        U.col(i) = u;
-        V.col(i) = v;
-        d(i)     = arma::as_scalar(u.t() * X * v);
+        U.col(i)      = u;
+        V.col(i)      = v;
+        d(i)          = X_op.bilinear(u, v);
+        outer_iter(i) = n_outer_iter;
+        inner_iter(i) = n_inner_iter;
         // deflate X
         if (i < rank - 1)
         {
@@ -329,10 +386,11 @@ Rcpp::List MoMA::multi_rank(int rank, arma::vec initial_u, arma::vec initial_v)
             // MoMA::X = MoMA::X - d u v^T
         }
     }
-    return Rcpp::List::create(Rcpp::Named("lambda_u") = lambda_u,
-                              Rcpp::Named("lambda_v") = lambda_v, Rcpp::Named("alpha_u") = alpha_u,
-                              Rcpp::Named("alpha_v") = alpha_v, Rcpp::Named("u") = U,
-                              Rcpp::Named("v") = V, Rcpp::Named("d") = d);
+    return Rcpp::List::create(
+        Rcpp::Named("lambda_u") = lambda_u, Rcpp::Named("lambda_v") = lambda_v,
+        Rcpp::Named("alpha_u") = alpha_u, Rcpp::Named("alpha_v") = alpha_v, Rcpp::Named("u") = U,
+        Rcpp::Named("v") = V, Rcpp::Named("d") = d, Rcpp::Named("n_outer_iter") = outer_iter,
+        Rcpp::Named("n_inner_iter") = inner_iter);
 }
 
 // 1. Return a list
@@ -342,7 +400,9 @@ Rcpp::List MoMA::multi_rank(int rank, arma::vec initial_u, arma::vec initial_v)
 // Rcpp::Named("alpha_v") = alpha_v,
 // Rcpp::Named("u") = U,
 // Rcpp::Named("v") = V,
-// Rcpp::Named("d") = d
+// Rcpp::Named("d") = d,
+// Rcpp::Named("n_outer_iter"), the number of outer iterations spent on each grid point
+// Rcpp::Named("n_inner_iter"), the number of inner iterations spent on each grid point
 // 2. Dependence on MoMA's internal states: MoMA::X.
 // 3. After calling grid_search, MoMA::u and MoMA::v
 // are the solution evaluated at the last grid point, using
@@ -361,9 +421,11 @@ Rcpp::List MoMA::grid_search(const arma::vec &alpha_u,
     int n_alpha_v  = alpha_v.n_elem;
     int n_total    = n_lambda_v * n_lambda_u * n_alpha_u * n_alpha_v;
 
-    arma::mat U(X.n_rows, n_total);
-    arma::mat V(X.n_cols, n_total);
+    arma::mat U(X_op.n_rows(), n_total);
+    arma::mat V(X_op.n_cols(), n_total);
     arma::vec d(n_total);
+    arma::vec outer_iter(n_total);
+    arma::vec inner_iter(n_total);
 
     int problem_id = 0;
     // MoMA::u and MoMA::v are initialzed as
@@ -385,9 +447,11 @@ Rcpp::List MoMA::grid_search(const arma::vec &alpha_u,
                     // MoMA::solve use the result from last
                     // iteration as starting point
                     solve();
-                    U.col(problem_id) = u;
-                    V.col(problem_id) = v;
-                    d(problem_id)     = arma::as_scalar(u.t() * X * v);
+                    U.col(problem_id)      = u;
+                    V.col(problem_id)      = v;
+                    d(problem_id)          = X_op.bilinear(u, v);
+                    outer_iter(problem_id) = n_outer_iter;
+                    inner_iter(problem_id) = n_inner_iter;
 
                     problem_id++;
                 }
@@ -398,8 +462,9 @@ Rcpp::List MoMA::grid_search(const arma::vec &alpha_u,
     {
         MoMALogger::error("Internal error: solution not found for all grid points.");
     }
-    return Rcpp::List::create(Rcpp::Named("lambda_u") = lambda_u,
-                              Rcpp::Named("lambda_v") = lambda_v, Rcpp::Named("alpha_u") = alpha_u,
-                              Rcpp::Named("alpha_v") = alpha_v, Rcpp::Named("u") = U,
-                              Rcpp::Named("v") = V, Rcpp::Named("d") = d);
+    return Rcpp::List::create(
+        Rcpp::Named("lambda_u") = lambda_u, Rcpp::Named("lambda_v") = lambda_v,
+        Rcpp::Named("alpha_u") = alpha_u, Rcpp::Named("alpha_v") = alpha_v, Rcpp::Named("u") = U,
+        Rcpp::Named("v") = V, Rcpp::Named("d") = d, Rcpp::Named("n_outer_iter") = outer_iter,
+        Rcpp::Named("n_inner_iter") = inner_iter);
 }
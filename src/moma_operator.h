@@ -0,0 +1,441 @@
+// -*- mode: C++; c-indent-level: 4; c-basic-offset: 4; indent-tabs-mode: nil;
+// -*-
+#ifndef MOMA_OPERATOR_H
+#define MOMA_OPERATOR_H 1
+
+#include "moma_base.h"
+#include "moma_logging.h"
+
+// A linear map A: R^p -> R^n which we only touch through
+// matrix-vector products, so that iterative algorithms (e.g.,
+// the Lanczos routines in `moma_lanczos.h`) do not care how
+// the matrix is stored.
+class LinearOperator
+{
+  public:
+    virtual ~LinearOperator() = default;
+    virtual int n_rows() const = 0;
+    virtual int n_cols() const = 0;
+
+    // A * v
+    virtual arma::vec times(const arma::vec &v) const = 0;
+    // A^T * u
+    virtual arma::vec trans_times(const arma::vec &u) const = 0;
+
+    // u^T * A * v
+    virtual double bilinear(const arma::vec &u, const arma::vec &v) const
+    {
+        return arma::dot(u, times(v));
+    }
+
+    // Form A explicitly. Should only be used on small problems
+    // or when the matrix has to be returned to R.
+    virtual arma::mat dense() const = 0;
+
+    // The Gram matrix A^T A
+    virtual arma::mat gram() const
+    {
+        arma::mat D = dense();
+        return D.t() * D;
+    }
+
+    // Whether A is stored as a sparse matrix, in which case forming
+    // it explicitly is to be avoided.
+    virtual bool is_sparse() const { return false; }
+};
+
+// Whether the products with x should skip its zero entries, i.e., whether
+// x has at most MOMA_SPARSE_MATVEC_RATIO of its entries nonzero, in
+// which case `support` is set to their indices. Penalized u and v are
+// often this sparse.
+inline bool is_sparse_vector(const arma::vec &x, arma::uvec &support)
+{
+    support = arma::find(x);
+    return support.n_elem <= MOMA_SPARSE_MATVEC_RATIO * x.n_elem;
+}
+
+// A thin wrapper around a dense matrix. Products with sparse vectors
+// only touch the matching columns (or rows) of the matrix.
+class DenseOperator : public LinearOperator
+{
+  private:
+    const arma::mat A;
+
+  public:
+    explicit DenseOperator(const arma::mat &i_A) : A(i_A){};
+    // Use the memory of a column-major matrix without a copy, e.g., a
+    // matrix from R. It must outlive the operator.
+    DenseOperator(const double *mem, int n_rows, int n_cols)
+        : A(const_cast<double *>(mem), n_rows, n_cols, false, true){};
+
+    int n_rows() const { return A.n_rows; }
+    int n_cols() const { return A.n_cols; }
+    arma::vec times(const arma::vec &v) const
+    {
+        arma::uvec support;
+        if (!is_sparse_vector(v, support))
+        {
+            return A * v;
+        }
+        arma::vec res(A.n_rows, arma::fill::zeros);
+        for (arma::uword j : support)
+        {
+            res += v(j) * A.col(j);
+        }
+        return res;
+    }
+
+    arma::vec trans_times(const arma::vec &u) const
+    {
+        arma::uvec support;
+        if (!is_sparse_vector(u, support))
+        {
+            return A.t() * u;
+        }
+        return A.rows(support).t() * u.elem(support);
+    }
+
+    // Only the block of A where both u and v are nonzero is read
+    double bilinear(const arma::vec &u, const arma::vec &v) const
+    {
+        arma::uvec support_u;
+        arma::uvec support_v;
+        if (!is_sparse_vector(u, support_u) || !is_sparse_vector(v, support_v))
+        {
+            return arma::dot(u, times(v));
+        }
+        return arma::dot(u.elem(support_u), A.submat(support_u, support_v) * v.elem(support_v));
+    }
+
+    arma::mat dense() const { return A; }
+    arma::mat gram() const { return A.t() * A; }
+};
+
+// A sparse matrix A, optionally centered and scaled column-wise as
+// R's `scale` does, i.e., the operator is (A - 1 c^T) diag(1 / s).
+// Centering would destroy the sparsity, so it is applied implicitly:
+// products cost O(nnz(A) + n + p).
+class SparseOperator : public LinearOperator
+{
+  private:
+    const arma::sp_mat A;
+    arma::vec center;  // c, empty if not centered
+    arma::vec scale;   // s, empty if not scaled
+
+  public:
+    SparseOperator(const arma::sp_mat &i_A,
+                   const arma::vec &i_center = arma::vec(),
+                   const arma::vec &i_scale  = arma::vec())
+        : A(i_A), center(i_center), scale(i_scale)
+    {
+        if ((center.n_elem > 0 && center.n_elem != A.n_cols) ||
+            (scale.n_elem > 0 && scale.n_elem != A.n_cols))
+        {
+            MoMALogger::error("Wrong dimension of centering or scaling vector in SparseOperator.");
+        }
+    };
+
+    int n_rows() const { return A.n_rows; }
+    int n_cols() const { return A.n_cols; }
+    bool is_sparse() const { return true; }
+
+    // With a sparse v, only the matching columns of A are visited. A
+    // sparse u does not help A^T u, as the rows of A are not contiguous.
+    arma::vec times(const arma::vec &v) const
+    {
+        arma::vec w = scale.n_elem > 0 ? arma::vec(v / scale) : v;
+        arma::uvec support;
+        arma::vec res;
+        if (is_sparse_vector(w, support))
+        {
+            res.zeros(A.n_rows);
+            for (arma::uword j : support)
+            {
+                res += w(j) * A.col(j);
+            }
+        }
+        else
+        {
+            res = A * w;
+        }
+        if (center.n_elem > 0)
+        {
+            res -= arma::dot(center, w);
+        }
+        return res;
+    }
+
+    arma::vec trans_times(const arma::vec &u) const
+    {
+        arma::vec res = (u.t() * A).t();
+        if (center.n_elem > 0)
+        {
+            res -= arma::sum(u) * center;
+        }
+        if (scale.n_elem > 0)
+        {
+            res /= scale;
+        }
+        return res;
+    }
+
+    arma::mat dense() const
+    {
+        arma::mat res(A);
+        if (center.n_elem > 0)
+        {
+            res.each_row() -= center.t();
+        }
+        if (scale.n_elem > 0)
+        {
+            res.each_row() /= scale.t();
+        }
+        return res;
+    }
+};
+
+// The cross product X^T Y, applied as X^T (Y v) and Y^T (X u) so
+// that the p x q matrix is never formed. The memory cost is that of
+// X and Y, i.e., O(n (p + q)) instead of O(pq), or O(nnz) if they
+// are sparse.
+class CrossProductOperator : public LinearOperator
+{
+  private:
+    const LinearOperator &X;  // n x p
+    const LinearOperator &Y;  // n x q
+
+  public:
+    CrossProductOperator(const LinearOperator &i_X, const LinearOperator &i_Y) : X(i_X), Y(i_Y)
+    {
+        if (X.n_rows() != Y.n_rows())
+        {
+            MoMALogger::error(
+                "X and Y should have the same number of rows in CrossProductOperator.");
+        }
+    };
+
+    int n_rows() const { return X.n_cols(); }
+    int n_cols() const { return Y.n_cols(); }
+    bool is_sparse() const { return X.is_sparse() || Y.is_sparse(); }
+    arma::vec times(const arma::vec &v) const { return X.trans_times(Y.times(v)); }
+    arma::vec trans_times(const arma::vec &u) const { return Y.trans_times(X.times(u)); }
+    arma::mat dense() const { return X.dense().t() * Y.dense(); }
+};
+
+// The n x K class indicator matrix Y of LDA, scaled by `scale`, i.e.,
+// Y(i, k) = scale if the i-th sample belongs to class k and 0 otherwise.
+// We only store the labels: products with Y are grouped sums and
+// scatters, which cost O(n) instead of the O(nK) of a dense matrix.
+class ClassIndicator : public LinearOperator
+{
+  private:
+    arma::uvec labels;  // 0-based class labels
+    int n_class;
+    double scale;
+
+  public:
+    ClassIndicator() : n_class(0), scale(1){};
+    ClassIndicator(const arma::uvec &i_labels, int i_n_class, double i_scale)
+        : labels(i_labels), n_class(i_n_class), scale(i_scale)
+    {
+        if (labels.n_elem > 0 && (int)labels.max() >= n_class)
+        {
+            MoMALogger::error("Class labels should be smaller than the number of classes.");
+        }
+    };
+
+    int n_rows() const { return labels.n_elem; }
+    int n_cols() const { return n_class; }
+
+    arma::vec times(const arma::vec &v) const
+    {
+        arma::vec res(labels.n_elem);
+        for (int i = 0; i < (int)labels.n_elem; i++)
+        {
+            res(i) = scale * v(labels(i));
+        }
+        return res;
+    }
+
+    arma::vec trans_times(const arma::vec &x) const
+    {
+        arma::vec res(n_class, arma::fill::zeros);
+        for (int i = 0; i < (int)labels.n_elem; i++)
+        {
+            res(labels(i)) += x(i);
+        }
+        return scale * res;
+    }
+
+    arma::mat dense() const
+    {
+        arma::mat res(labels.n_elem, n_class, arma::fill::zeros);
+        for (int i = 0; i < (int)labels.n_elem; i++)
+        {
+            res(i, labels(i)) = scale;
+        }
+        return res;
+    }
+
+    // X^T Y, formed by summing the rows of X within each class in O(np)
+    arma::mat cross_product(const arma::mat &X) const
+    {
+        if (X.n_rows != labels.n_elem)
+        {
+            MoMALogger::error("X and the class labels should have the same number of samples.");
+        }
+        arma::mat res(X.n_cols, n_class, arma::fill::zeros);
+        for (int j = 0; j < (int)X.n_cols; j++)
+        {
+            for (int i = 0; i < (int)X.n_rows; i++)
+            {
+                res(j, labels(i)) += X(i, j);
+            }
+        }
+        return scale * res;
+    }
+};
+
+// A deflated matrix A - sum_i a_i b_i^T. The corrections are kept
+// as the columns of two thin matrices, so that the base operator
+// is never rewritten and a deflation costs O((n + p)) memory
+// instead of O(np).
+class DeflatedOperator : public LinearOperator
+{
+  private:
+    const LinearOperator &base;
+    arma::mat A;  // n x k, left factors of the corrections
+    arma::mat B;  // p x k, right factors of the corrections
+
+  public:
+    explicit DeflatedOperator(const LinearOperator &i_base)
+        : base(i_base), A(i_base.n_rows(), 0), B(i_base.n_cols(), 0){};
+
+    int n_rows() const { return base.n_rows(); }
+    int n_cols() const { return base.n_cols(); }
+    bool is_sparse() const { return base.is_sparse(); }
+    int rank() const { return A.n_cols; }
+
+    arma::vec times(const arma::vec &v) const
+    {
+        arma::vec res = base.times(v);
+        if (A.n_cols > 0)
+        {
+            res -= A * (B.t() * v);
+        }
+        return res;
+    }
+
+    arma::vec trans_times(const arma::vec &u) const
+    {
+        arma::vec res = base.trans_times(u);
+        if (A.n_cols > 0)
+        {
+            res -= B * (A.t() * u);
+        }
+        return res;
+    }
+
+    double bilinear(const arma::vec &u, const arma::vec &v) const
+    {
+        double res = base.bilinear(u, v);
+        if (A.n_cols > 0)
+        {
+            res -= arma::dot(A.t() * u, B.t() * v);
+        }
+        return res;
+    }
+
+    arma::mat dense() const
+    {
+        arma::mat res = base.dense();
+        if (A.n_cols > 0)
+        {
+            res -= A * B.t();
+        }
+        return res;
+    }
+
+    // The Gram matrix of the deflated operator given that of the base,
+    // (M - A B^T)^T (M - A B^T), where only M^T A needs products with M
+    arma::mat gram(const arma::mat &base_gram) const
+    {
+        if (A.n_cols == 0)
+        {
+            return base_gram;
+        }
+        arma::mat MtA(n_cols(), A.n_cols);
+        for (int k = 0; k < (int)A.n_cols; k++)
+        {
+            MtA.col(k) = base.trans_times(A.col(k));
+        }
+        arma::mat BAtM = B * MtA.t();
+        return base_gram - BAtM - BAtM.t() + B * (A.t() * A) * B.t();
+    }
+
+    // Subtract a b^T from the operator
+    void subtract(const arma::vec &a, const arma::vec &b)
+    {
+        if ((int)a.n_elem != n_rows() || (int)b.n_elem != n_cols())
+        {
+            MoMALogger::error("Wrong dimension in DeflatedOperator::subtract.");
+        }
+        A.insert_cols(A.n_cols, a);
+        B.insert_cols(B.n_cols, b);
+    }
+
+    // Drop all corrections
+    void reset()
+    {
+        A.set_size(n_rows(), 0);
+        B.set_size(n_cols(), 0);
+    }
+};
+
+// A * x, or A^T * x, for the last x seen. When x changes on few
+// coordinates, the new product is the cached one plus A * (x_new - x),
+// which only reads the columns of A where x changed (see `is_sparse_vector`).
+// The cache knows nothing about A, so it must be cleared whenever A changes.
+class ProductCache
+{
+  private:
+    bool transposed;  // whether to cache A^T * x
+    arma::vec x;
+    arma::vec Ax;
+    int n_updates;  // number of deltas added since the last full product
+
+  public:
+    explicit ProductCache(bool i_transposed = false) : transposed(i_transposed), n_updates(0){};
+
+    void clear()
+    {
+        x.reset();
+        Ax.reset();
+        n_updates = 0;
+    }
+
+    arma::vec times(const LinearOperator &A, const arma::vec &x_new)
+    {
+        if (x.n_elem == x_new.n_elem && n_updates < MOMA_PRODUCT_CACHE_REFRESH)
+        {
+            arma::vec dx = x_new - x;
+            arma::uvec support;
+            if (is_sparse_vector(dx, support))
+            {
+                if (support.n_elem > 0)
+                {
+                    Ax += transposed ? A.trans_times(dx) : A.times(dx);
+                    x = x_new;
+                    n_updates++;
+                }
+                return Ax;
+            }
+        }
+        Ax        = transposed ? A.trans_times(x_new) : A.times(x_new);
+        x         = x_new;
+        n_updates = 0;
+        return Ax;
+    }
+};
+
+#endif
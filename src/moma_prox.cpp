@@ -14,6 +14,14 @@ arma::vec NullProx::operator()(const arma::vec &x, double l)
                // copying.
 };
 
+void NullProx::apply(const arma::vec &x, double l, arma::vec &out)
+{
+    if (&out != &x)
+    {
+        out = x;  // no allocation if `out` is of the right size
+    }
+}
+
 NullProx::~NullProx()
 {
     MoMALogger::debug("Releasing null proximal operator object");
@@ -34,8 +42,19 @@ Lasso::Lasso()
 
 arma::vec Lasso::operator()(const arma::vec &x, double l)
 {
-    arma::vec absx = arma::abs(x);
-    return arma::sign(x) % soft_thres_p(absx, l);
+    arma::vec z(x.n_elem);
+    apply(x, l, z);
+    return z;
+}
+
+void Lasso::apply(const arma::vec &x, double l, arma::vec &out)
+{
+    int n = x.n_elem;
+    out.set_size(n);
+    for (int i = 0; i < n; i++)
+    {
+        out(i) = threshold(x(i), l);
+    }
 }
 
 Lasso::~Lasso()
@@ -48,6 +67,25 @@ int Lasso::df(const arma::vec &x)
     return arma::sum(x != 0.0);
 }
 
+double Lasso::value(const arma::vec &x) const
+{
+    return arma::norm(x, 1);
+}
+
+void Lasso::jacobian_times(const arma::vec &x,
+                           const arma::vec &z,
+                           double l,
+                           const arma::vec &d,
+                           arma::vec &out) const
+{
+    // diagonal, with ones where x is not thresholded
+    out.set_size(x.n_elem);
+    for (arma::uword i = 0; i < x.n_elem; i++)
+    {
+        out(i) = std::abs(x(i)) > l ? d(i) : 0.0;
+    }
+}
+
 /*
  * SLOPE - Sorted L-One Penalized Estimation
  */
@@ -105,7 +143,19 @@ NonNegativeLasso::NonNegativeLasso()
 
 arma::vec NonNegativeLasso::operator()(const arma::vec &x, double l)
 {
-    return soft_thres_p(x, l);
+    arma::vec z(x.n_elem);
+    apply(x, l, z);
+    return z;
+}
+
+void NonNegativeLasso::apply(const arma::vec &x, double l, arma::vec &out)
+{
+    int n = x.n_elem;
+    out.set_size(n);
+    for (int i = 0; i < n; i++)
+    {
+        out(i) = threshold(x(i), l);
+    }
 }
 
 NonNegativeLasso::~NonNegativeLasso()
@@ -113,6 +163,25 @@ NonNegativeLasso::~NonNegativeLasso()
     MoMALogger::debug("Releasing non-negative Lasso proximal operator object");
 }
 
+double NonNegativeLasso::value(const arma::vec &x) const
+{
+    // x is non-negative
+    return arma::norm(x, 1);
+}
+
+void NonNegativeLasso::jacobian_times(const arma::vec &x,
+                                      const arma::vec &z,
+                                      double l,
+                                      const arma::vec &d,
+                                      arma::vec &out) const
+{
+    out.set_size(x.n_elem);
+    for (arma::uword i = 0; i < x.n_elem; i++)
+    {
+        out(i) = x(i) > l ? d(i) : 0.0;
+    }
+}
+
 int NonNegativeLasso::df(const arma::vec &x)
 {
     return arma::sum(x != 0.0);
@@ -138,23 +207,19 @@ SCAD::~SCAD()
 
 arma::vec SCAD::operator()(const arma::vec &x, double l)
 {
-    int n     = x.n_elem;
-    double gl = gamma * l;
-    arma::vec z(n);
-    arma::vec absx = arma::abs(x);
-    arma::vec sgnx = arma::sign(x);
-    for (int i = 0; i < n; i++)  // Probably need vectorization
+    arma::vec z(x.n_elem);
+    apply(x, l, z);
+    return z;
+}
+
+void SCAD::apply(const arma::vec &x, double l, arma::vec &out)
+{
+    int n = x.n_elem;
+    out.set_size(n);
+    for (int i = 0; i < n; i++)
     {
-        // The implementation follows
-        // Variable Selection via Nonconcave Penalized Likelihood and its Oracle
-        // Properties Jianqing Fan nd Runze Li formula(2.8).
-        z(i) = absx(i) > gl
-                   ? absx(i)
-                   : (absx(i) > 2 * l ?  //(gamma-1)/(gamma-2) * THRES_P(absx(i),gamma*l/(gamma-1))
-                          ((gamma - 1) * absx(i) - gl) / (gamma - 2)
-                                      : THRES_P(absx(i), l));
+        out(i) = threshold(x(i), l);
     }
-    return z % sgnx;
 }
 
 arma::vec SCAD::vec_prox(const arma::vec &x, double l)
@@ -201,21 +266,19 @@ NonNegativeSCAD::~NonNegativeSCAD()
 
 arma::vec NonNegativeSCAD::operator()(const arma::vec &x, double l)
 {
-    int n     = x.n_elem;
-    double gl = gamma * l;
-    arma::vec z(n);
-    for (int i = 0; i < n; i++)  // Probably need vectorization
+    arma::vec z(x.n_elem);
+    apply(x, l, z);
+    return z;
+}
+
+void NonNegativeSCAD::apply(const arma::vec &x, double l, arma::vec &out)
+{
+    int n = x.n_elem;
+    out.set_size(n);
+    for (int i = 0; i < n; i++)
     {
-        // The implementation follows
-        // Variable Selection via Nonconcave Penalized Likelihood and its Oracle
-        // Properties Jianqing Fan and Runze Li formula(2.8).
-        z(i) = x(i) > gl
-                   ? x(i)
-                   : (x(i) > 2 * l ?  //(gamma-1)/(gamma-2) * THRES_P(absx(i),gamma*l/(gamma-1))
-                          ((gamma - 1) * x(i) - gl) / (gamma - 2)
-                                   : THRES_P(x(i), l));
+        out(i) = threshold(x(i), l);
     }
-    return z;
 }
 
 int NonNegativeSCAD::df(const arma::vec &x)
@@ -243,19 +306,20 @@ MCP::~MCP()
 }
 
 arma::vec MCP::operator()(const arma::vec &x, double l)
+{
+    arma::vec z(x.n_elem);
+    apply(x, l, z);
+    return z;
+}
+
+void MCP::apply(const arma::vec &x, double l, arma::vec &out)
 {
     int n = x.n_elem;
-    arma::vec z(n);
-    arma::vec absx = arma::abs(x);
-    arma::vec sgnx = arma::sign(x);
+    out.set_size(n);
     for (int i = 0; i < n; i++)
     {
-        // implementation follows lecture notes of Patrick Breheny
-        // http://myweb.uiowa.edu/pbreheny/7600/s16/notes/2-29.pdf
-        // slide 19
-        z(i) = absx(i) > gamma * l ? absx(i) : (gamma / (gamma - 1)) * THRES_P(absx(i), l);
+        out(i) = threshold(x(i), l);
     }
-    return z % sgnx;
 }
 
 arma::vec MCP::vec_prox(const arma::vec &x, double l)
@@ -299,17 +363,20 @@ NonNegativeMCP::~NonNegativeMCP()
 }
 
 arma::vec NonNegativeMCP::operator()(const arma::vec &x, double l)
+{
+    arma::vec z(x.n_elem);
+    apply(x, l, z);
+    return z;
+}
+
+void NonNegativeMCP::apply(const arma::vec &x, double l, arma::vec &out)
 {
     int n = x.n_elem;
-    arma::vec z(n);
+    out.set_size(n);
     for (int i = 0; i < n; i++)
     {
-        // implementation follows lecture notes of Patrick Breheny
-        // http://myweb.uiowa.edu/pbreheny/7600/s16/notes/2-29.pdf
-        // slide 19
-        z(i) = x(i) > gamma * l ? x(i) : (gamma / (gamma - 1)) * THRES_P(x(i), l);
+        out(i) = threshold(x(i), l);
     }
-    return z;
 }
 
 int NonNegativeMCP::df(const arma::vec &x)
@@ -374,6 +441,44 @@ int GrpLasso::df(const arma::vec &x)
     return arma::sum(grp_norm != 0.0) + x.n_elem - n_grp;
 }
 
+double GrpLasso::value(const arma::vec &x) const
+{
+    arma::vec grp_norm = arma::zeros<arma::vec>(n_grp);
+    for (arma::uword i = 0; i < x.n_elem; i++)
+    {
+        grp_norm(group(i)) += x(i) * x(i);
+    }
+    return arma::accu(arma::sqrt(grp_norm));
+}
+
+void GrpLasso::jacobian_times(const arma::vec &x,
+                              const arma::vec &z,
+                              double l,
+                              const arma::vec &d,
+                              arma::vec &out) const
+{
+    // Block diagonal. For a group with || x_g || > l, the block is
+    // (1 - l / || x_g ||) I + l / || x_g ||^3 x_g x_g^T, otherwise 0.
+    arma::vec grp_norm = arma::zeros<arma::vec>(n_grp);
+    arma::vec grp_xd   = arma::zeros<arma::vec>(n_grp);
+    for (arma::uword i = 0; i < x.n_elem; i++)
+    {
+        grp_norm(group(i)) += x(i) * x(i);
+        grp_xd(group(i)) += x(i) * d(i);
+    }
+    grp_norm = arma::sqrt(grp_norm);
+    out.set_size(x.n_elem);
+    for (arma::uword i = 0; i < x.n_elem; i++)
+    {
+        double nrm = grp_norm(group(i));
+        out(i)     = 0.0;
+        if (nrm > l)
+        {
+            out(i) = (1 - l / nrm) * d(i) + l / (nrm * nrm * nrm) * x(i) * grp_xd(group(i));
+        }
+    }
+}
+
 /*
  * Non-negative group lasso
  */
@@ -481,6 +586,38 @@ OrderedFusedLassoDP::~OrderedFusedLassoDP()
     MoMALogger::debug("Releasing a ordered fusion lasso proximal operator object (DP)");
 }
 
+double OrderedFusedLasso::value(const arma::vec &x) const
+{
+    double res = 0;
+    for (int i = 0; i + 1 < (int)x.n_elem; i++)
+    {
+        res += std::abs(x(i + 1) - x(i));
+    }
+    return res;
+}
+
+void OrderedFusedLasso::jacobian_times(const arma::vec &x,
+                                       const arma::vec &z,
+                                       double l,
+                                       const arma::vec &d,
+                                       arma::vec &out) const
+{
+    // The projection onto vectors that are constant on the fused
+    // groups of z, i.e., d is averaged within each group
+    int n = z.n_elem;
+    out.set_size(n);
+    int start = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (i + 1 == n || z(i + 1) != z(start))
+        {
+            double mean = arma::mean(d.subvec(start, i));
+            out.subvec(start, i).fill(mean);
+            start = i + 1;
+        }
+    }
+}
+
 arma::vec OrderedFusedLassoDP::operator()(const arma::vec &x, double l)
 {
     return myflsadp(x, l, MOMA_FUSEDLASSODP_BUFFERSIZE);
@@ -967,7 +1104,36 @@ arma::vec ProxOp::operator()(const arma::vec &x, double l)
     return (*p)(x, l);
 }
 
+void ProxOp::apply(const arma::vec &x, double l, arma::vec &out)
+{
+    (*p).apply(x, l, out);
+}
+
 int ProxOp::df(const arma::vec &x)
 {
     return (*p).df(x);
 }
+
+bool ProxOp::is_norm_like() const
+{
+    return (*p).is_norm_like();
+}
+
+bool ProxOp::has_jacobian() const
+{
+    return (*p).has_jacobian();
+}
+
+double ProxOp::value(const arma::vec &x) const
+{
+    return (*p).value(x);
+}
+
+void ProxOp::jacobian_times(const arma::vec &x,
+                            const arma::vec &z,
+                            double l,
+                            const arma::vec &d,
+                            arma::vec &out) const
+{
+    (*p).jacobian_times(x, z, l, d, out);
+}
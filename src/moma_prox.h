@@ -33,6 +33,39 @@ class Prox
     virtual arma::vec operator()(const arma::vec &x, double l) = 0;
     virtual ~Prox()                                            = default;
     virtual int df(const arma::vec &x)                         = 0;
+
+    // Write the result to a pre-allocated `out`, so that iterative
+    // solvers do not allocate in every iteration. Separable penalties
+    // override it with an in-place loop; `out` may alias `x` for them.
+    virtual void apply(const arma::vec &x, double l, arma::vec &out) { out = (*this)(x, l); }
+
+    // Whether the penalty is positively homogeneous of degree one, i.e., a
+    // (semi-)norm, possibly restricted to the non-negative orthant. If so,
+    // min_u || y - u ||^2 + lambda P(u) s.t. || u || <= 1 is solved by
+    // normalizing prox(y, lambda). Non-convex penalties such as SCAD and MCP
+    // do not qualify.
+    virtual bool is_norm_like() const { return false; }
+
+    // Second-order information used by the semi-smooth Newton solver
+    // (see `SSNAL` in `moma_solver.h`), only defined if has_jacobian()
+    // is true.
+    virtual bool has_jacobian() const { return false; }
+    // The penalty P(x)
+    virtual double value(const arma::vec &x) const
+    {
+        MoMALogger::error("Penalty value is not implemented for this penalty.");
+        return 0;
+    }
+    // out = J d, where J is an element of the generalized Jacobian
+    // of prox(., l) at x, and z = prox(x, l)
+    virtual void jacobian_times(const arma::vec &x,
+                                const arma::vec &z,
+                                double l,
+                                const arma::vec &d,
+                                arma::vec &out) const
+    {
+        MoMALogger::error("Generalized Jacobian is not implemented for this penalty.");
+    }
 };
 
 class NullProx : public Prox
@@ -40,8 +73,13 @@ class NullProx : public Prox
   public:
     NullProx();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    // Separable penalties define the prox of a single coordinate, which
+    // the solvers in `moma_solver.h` inline into their loops
+    double threshold(double x, double l) const { return x; }
     ~NullProx();
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
 };
 
 class Lasso : public Prox
@@ -49,8 +87,18 @@ class Lasso : public Prox
   public:
     Lasso();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    double threshold(double x, double l) const { return x > l ? x - l : (x < -l ? x + l : 0.0); }
     ~Lasso();
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
+    bool has_jacobian() const { return true; }
+    double value(const arma::vec &x) const;
+    void jacobian_times(const arma::vec &x,
+                        const arma::vec &z,
+                        double l,
+                        const arma::vec &d,
+                        arma::vec &out) const;
 };
 
 class SLOPE : public Prox
@@ -62,6 +110,7 @@ class SLOPE : public Prox
     arma::vec operator()(const arma::vec &x, double l);
     ~SLOPE();
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
 };
 
 class NonNegativeLasso : public Prox
@@ -69,8 +118,18 @@ class NonNegativeLasso : public Prox
   public:
     NonNegativeLasso();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    double threshold(double x, double l) const { return THRES_P(x, l); }
     ~NonNegativeLasso();
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
+    bool has_jacobian() const { return true; }
+    double value(const arma::vec &x) const;
+    void jacobian_times(const arma::vec &x,
+                        const arma::vec &z,
+                        double l,
+                        const arma::vec &d,
+                        arma::vec &out) const;
 };
 
 class SCAD : public Prox
@@ -81,6 +140,18 @@ class SCAD : public Prox
     SCAD(double g = 3.7);
     ~SCAD();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    double threshold(double x, double l) const
+    {
+        // The implementation follows
+        // Variable Selection via Nonconcave Penalized Likelihood and its Oracle
+        // Properties Jianqing Fan nd Runze Li formula(2.8).
+        double absx = std::abs(x);
+        double z    = absx > gamma * l ? absx
+                                    : (absx > 2 * l ? ((gamma - 1) * absx - gamma * l) / (gamma - 2)
+                                                    : THRES_P(absx, l));
+        return x > 0 ? z : (x < 0 ? -z : 0.0);
+    }
     arma::vec vec_prox(const arma::vec &x, double l);
     int df(const arma::vec &x);
 };
@@ -91,6 +162,13 @@ class NonNegativeSCAD : public SCAD
     NonNegativeSCAD(double g = 3.7);
     ~NonNegativeSCAD();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    double threshold(double x, double l) const
+    {
+        return x > gamma * l ? x
+                             : (x > 2 * l ? ((gamma - 1) * x - gamma * l) / (gamma - 2)
+                                          : THRES_P(x, l));
+    }
     int df(const arma::vec &x);
 };
 
@@ -102,6 +180,16 @@ class MCP : public Prox
     MCP(double g = 3);
     ~MCP();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    double threshold(double x, double l) const
+    {
+        // implementation follows lecture notes of Patrick Breheny
+        // http://myweb.uiowa.edu/pbreheny/7600/s16/notes/2-29.pdf
+        // slide 19
+        double absx = std::abs(x);
+        double z    = absx > gamma * l ? absx : (gamma / (gamma - 1)) * THRES_P(absx, l);
+        return x > 0 ? z : (x < 0 ? -z : 0.0);
+    }
     arma::vec vec_prox(const arma::vec &x, double l);
     int df(const arma::vec &x);
 };
@@ -112,6 +200,11 @@ class NonNegativeMCP : public MCP
     NonNegativeMCP(double g = 3);
     ~NonNegativeMCP();
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
+    double threshold(double x, double l) const
+    {
+        return x > gamma * l ? x : (gamma / (gamma - 1)) * THRES_P(x, l);
+    }
     int df(const arma::vec &x);
 };
 
@@ -126,6 +219,14 @@ class GrpLasso : public Prox
     arma::vec operator()(const arma::vec &x, double l);
     arma::vec vec_prox(const arma::vec &x, double l);
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
+    bool has_jacobian() const { return true; }
+    double value(const arma::vec &x) const;
+    void jacobian_times(const arma::vec &x,
+                        const arma::vec &z,
+                        double l,
+                        const arma::vec &d,
+                        arma::vec &out) const;
 };
 
 class NonNegativeGrpLasso : public GrpLasso
@@ -135,6 +236,8 @@ class NonNegativeGrpLasso : public GrpLasso
     ~NonNegativeGrpLasso();
     arma::vec operator()(const arma::vec &x, double l);
     int df(const arma::vec &x);
+    bool has_jacobian() const { return false; }
+    bool is_norm_like() const { return true; }
 };
 
 class OrderedFusedLasso : public Prox
@@ -144,6 +247,14 @@ class OrderedFusedLasso : public Prox
     ~OrderedFusedLasso();
     arma::vec operator()(const arma::vec &x, double l);
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
+    bool has_jacobian() const { return true; }
+    double value(const arma::vec &x) const;
+    void jacobian_times(const arma::vec &x,
+                        const arma::vec &z,
+                        double l,
+                        const arma::vec &d,
+                        arma::vec &out) const;
 };
 
 class OrderedFusedLassoDP : public OrderedFusedLasso
@@ -166,6 +277,9 @@ class SparseFusedLasso : public Prox
     ~SparseFusedLasso();
     arma::vec operator()(const arma::vec &x, double l);
     int df(const arma::vec &x);
+    // `lambda2` does not scale with the prox step `l`, so prox(y, lambda)
+    // is not the solution of the unsmoothed problem
+    bool is_norm_like() const { return false; }
 };
 
 class Fusion : public Prox
@@ -185,6 +299,7 @@ class Fusion : public Prox
     ~Fusion();
     arma::vec operator()(const arma::vec &x, double l);
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
 };
 
 // Its implementation is in `moma_prox_l1tf.cpp`
@@ -214,6 +329,7 @@ class L1TrendFiltering : public Prox
     ~L1TrendFiltering();
     arma::vec operator()(const arma::vec &x, double l);
     int df(const arma::vec &x);
+    bool is_norm_like() const { return true; }
 };
 
 // A handle class that deals with matching proximal operators
@@ -229,8 +345,18 @@ class ProxOp
     ProxOp(Rcpp::List prox_arg_list, int dim);
 
     ~ProxOp() { delete p; }
+    const Prox *get() const { return p; }
     arma::vec operator()(const arma::vec &x, double l);
+    void apply(const arma::vec &x, double l, arma::vec &out);
     int df(const arma::vec &x);
+    bool is_norm_like() const;
+    bool has_jacobian() const;
+    double value(const arma::vec &x) const;
+    void jacobian_times(const arma::vec &x,
+                        const arma::vec &z,
+                        double l,
+                        const arma::vec &d,
+                        arma::vec &out) const;
 };
 
 #endif
@@ -2,27 +2,138 @@
 // -*-
 #include "moma_solver.h"
 
+int bandwidth(const arma::sp_mat &A)
+{
+    int b = 0;
+    for (arma::uword j = 0; j < A.n_cols; j++)
+    {
+        for (arma::uword k = A.col_ptrs[j]; k < A.col_ptrs[j + 1]; k++)
+        {
+            b = std::max(b, std::abs((int)A.row_indices[k] - (int)j));
+        }
+    }
+    return b;
+}
+
+void BandedCholesky::factorize(const arma::sp_mat &A, double a, double c, int bandwidth)
+{
+    n = A.n_rows;
+    b = std::min(bandwidth, std::max(n - 1, 0));
+    band.zeros(b + 1, n);
+
+    // lower triangular part of c * I + a * A
+    for (int j = 0; j < n; j++)
+    {
+        band(0, j) = c;
+    }
+    if (a != 0.0)
+    {
+        for (arma::uword j = 0; j < A.n_cols; j++)
+        {
+            for (arma::uword k = A.col_ptrs[j]; k < A.col_ptrs[j + 1]; k++)
+            {
+                int i = A.row_indices[k];
+                if (i >= (int)j && i - (int)j <= b)
+                {
+                    band(i - j, j) += a * A.values[k];
+                }
+            }
+        }
+    }
+
+    // column-wise (left-looking) Cholesky on the band
+    for (int j = 0; j < n; j++)
+    {
+        double d = band(0, j);
+        for (int k = std::max(0, j - b); k < j; k++)
+        {
+            d -= band(j - k, k) * band(j - k, k);
+        }
+        if (d <= 0)
+        {
+            MoMALogger::error("Matrix is not positive definite in BandedCholesky::factorize.");
+        }
+        band(0, j) = std::sqrt(d);
+        for (int i = j + 1; i <= std::min(n - 1, j + b); i++)
+        {
+            double s = band(i - j, j);
+            for (int k = std::max(0, i - b); k < j; k++)
+            {
+                s -= band(i - k, k) * band(j - k, k);
+            }
+            band(i - j, j) = s / band(0, j);
+        }
+    }
+}
+
+void BandedCholesky::solve(arma::vec &x) const
+{
+    // L z = x
+    for (int i = 0; i < n; i++)
+    {
+        double s = x(i);
+        for (int k = std::max(0, i - b); k < i; k++)
+        {
+            s -= band(i - k, k) * x(k);
+        }
+        x(i) = s / band(0, i);
+    }
+    // L^T x = z
+    for (int i = n - 1; i >= 0; i--)
+    {
+        double s = x(i);
+        for (int k = i + 1; k <= std::min(n - 1, i + b); k++)
+        {
+            s -= band(k - i, i) * x(k);
+        }
+        x(i) = s / band(0, i);
+    }
+}
+
 // A handle class
 // Penalized regression solver
 // min_u || y - u || + lambda * P(u) s.t. || u ||_S <= 1
 // S = I + alpha * Omega
-arma::vec _PR_solver::normalize(const arma::vec &u)
+double _PR_solver::S_norm(const arma::vec &u)
 {
-    arma::vec res = u;
-    double mn     = is_S_idmat ? arma::norm(u) : arma::as_scalar(arma::sqrt(u.t() * S * u));
+    if (is_S_idmat)
+    {
+        return arma::norm(u);
+    }
+    // u^T S u = u^T u + alpha * u^T Omega u
+    return std::sqrt(arma::dot(u, u) + alpha * sp_quad_form(Omega, u));
+}
+
+void _PR_solver::normalize(arma::vec &u)
+{
+    double mn = S_norm(u);
     if (mn > 0)
     {
-        res /= mn;
+        u /= mn;
     }
     else
     {
-        res.zeros();
+        u.zeros();
     }
-    return res;
+}
+
+bool _PR_solver::has_closed_form()
+{
+    return is_S_idmat && p.is_norm_like();
+}
+
+arma::vec _PR_solver::closed_form_solve(const arma::vec &y)
+{
+    p.apply(y, lambda, work_u);
+    normalize(work_u);
+    last_iter = 0;
+    MoMALogger::debug("Solved PR in closed form.");
+    return work_u;
 }
 
 void _PR_solver::check_convergence(int iter, double tol)
 {
+    last_iter = iter;
     if (iter >= MAX_ITER || tol > EPS)
     {
         MoMALogger::warning("No convergence in _PR_solver!");
@@ -30,7 +141,7 @@ void _PR_solver::check_convergence(int iter, double tol)
 }
 
 _PR_solver::_PR_solver(double i_alpha,
-                       const arma::mat &i_Omega,
+                       const arma::sp_mat &i_Omega,
                        double i_lambda,
                        Rcpp::List prox_arg_list,
                        double i_EPS,
@@ -39,59 +150,89 @@ _PR_solver::_PR_solver(double i_alpha,
     : dim(i_dim),
       lambda(i_lambda),
       alpha(i_alpha),
-      Omega(i_Omega),  // reference to the matrix on the R side, no extra copy
+      Omega(i_Omega),
+      Omega_lambda_max(-1),
       p(prox_arg_list, i_dim),
       EPS(i_EPS),
-      MAX_ITER(i_MAX_ITER)
+      MAX_ITER(i_MAX_ITER),
+      last_iter(0)
 {
+    if ((int)Omega.n_rows != dim || (int)Omega.n_cols != dim)
+    {
+        MoMALogger::error("Wrong dimension of the smoothing matrix in _PR_solver.");
+    }
+    Omega.sync();  // we access the CSC arrays of Omega directly
+    work_u.set_size(dim);
+    work_oldu.set_size(dim);
+    work_newu.set_size(dim);
+    work_grad.set_size(dim);
     // Step 1b: Calculate leading eigenvalues of smoothing matrices
     //          -> used for prox gradient step sizes
-    S.eye(arma::size(Omega));
-    S += alpha * Omega;
-    L = arma::eig_sym(S).max() + MOMA_EIGENVALUE_REGULARIZATION;
+    set_step_size();
+    is_S_idmat = (alpha == 0.0);
+}
 
-    grad_step_size = 1 / L;
-    prox_step_size = lambda / L;
-    is_S_idmat     = (alpha == 0.0);
+// Omega is positive semi-definite, so its leading eigenvalue is also
+// its leading singular value, which the truncated SVD finds with
+// products with Omega only, i.e., without forming a dense matrix.
+// It is computed at most once per solver.
+double _PR_solver::leading_eigenvalue_Omega()
+{
+    if (Omega_lambda_max < 0)
+    {
+        if (dim <= MOMA_LANCZOS_MIN_DIM)
+        {
+            Omega_lambda_max = arma::eig_sym(arma::mat(Omega)).max();
+        }
+        else
+        {
+            arma::vec u;
+            arma::vec v;
+            leading_singular_triplet(SparseOperator(Omega), u, v, Omega_lambda_max);
+        }
+        Omega_lambda_max = std::max(Omega_lambda_max, 0.0);
+    }
+    return Omega_lambda_max;
 }
 
-arma::vec _PR_solver::g(const arma::vec &v,
-                        const arma::vec &y,
-                        double step_size,
-                        const arma::mat &S,
-                        bool is_S_idmat)
+void _PR_solver::set_step_size()
 {
-    arma::vec res;
-    if (is_S_idmat)
+    // lambda_max(I + alpha * Omega) = 1 + alpha * lambda_max(Omega)
+    L = 1 + MOMA_EIGENVALUE_REGULARIZATION;
+    if (alpha != 0.0)
     {
-        res = v + step_size * (y - v);
+        L += alpha * leading_eigenvalue_Omega();
     }
-    else
+
+    grad_step_size = 1 / L;
+    prox_step_size = lambda / L;
+}
+
+void _PR_solver::g(const arma::vec &v, const arma::vec &y, double step_size, arma::vec &out)
+{
+    // evaluated in place, `out` is of the right size
+    out = v + step_size * (y - v);
+    if (!is_S_idmat)
     {
-        res = v + step_size * (y - S * v);
+        // S v = v + alpha * Omega v
+        sp_times_add(Omega, v, -step_size * alpha, out);
     }
-    return res;
 }
 
 int _PR_solver::set_penalty(double new_lambda, double new_alpha)
 {
+    lambda = new_lambda;
     if (new_alpha != alpha)
     {
-        // avoid re-calculating L
-        // enter only when alpha is changed
-        S.eye(arma::size(S));
-        S += new_alpha * Omega;
-        L = arma::eig_sym(S).max() + MOMA_EIGENVALUE_REGULARIZATION;
-
-        grad_step_size = 1 / L;
-        prox_step_size = new_lambda / L;
+        // enter only when alpha is changed, which costs O(1)
+        // since the spectrum of Omega is cached
+        alpha = new_alpha;
+        set_step_size();
     }
-    else if (lambda != new_lambda)
+    else
     {
         prox_step_size = new_lambda / L;
     }
-    lambda     = new_lambda;
-    alpha      = new_alpha;
     is_S_idmat = (new_alpha == 0.0);
     return 0;
 }
@@ -119,120 +260,470 @@ double _PR_solver::bic(arma::vec y, const arma::vec &est)
 
 arma::vec ISTA::solve(arma::vec y, const arma::vec &start_point)
 {
-    if (start_point.n_elem != S.n_cols || y.n_elem != S.n_cols)
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
     {
         MoMALogger::error("Wrong dimension in PRsolver::solve:")
-            << start_point.n_elem << ":" << S.n_cols;
+            << start_point.n_elem << ":" << dim;
+    }
+    if (has_closed_form())
+    {
+        return closed_form_solve(y);
     }
-    double tol  = 1;
-    int iter    = 0;
-    arma::vec u = start_point;
-    arma::vec oldu;  // store working result
+    double tol = 1;
+    int iter   = 0;
+    work_u     = start_point;
 
     while (tol > EPS && iter < MAX_ITER)
     {
         iter++;
-        oldu = u;
+        work_u.swap(work_oldu);  // store working result
 
-        u = g(u, y, grad_step_size, S, is_S_idmat);
-        u = p(u, prox_step_size);
+        g(work_oldu, y, grad_step_size, work_grad);
+        p.apply(work_grad, prox_step_size, work_u);
 
-        double old_norm  = arma::norm(oldu);
-        double diff_norm = arma::norm(u - oldu);
-
-        if (old_norm != 0.0)
-            tol = diff_norm / old_norm;
-        else
-        {
-            tol = diff_norm;
-        }
+        tol = relative_change(work_u, work_oldu);
         if (iter % 1000 == 0)
         {
             MoMALogger::debug("Solving PR: No.") << iter << "--" << tol;
         }
     }
-    u = normalize(u);
+    normalize(work_u);
 
     MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
         << "(" << iter << "," << tol << ")";
     check_convergence(iter, tol);
-    return u;
+    return work_u;
 }
 
 arma::vec FISTA::solve(arma::vec y, const arma::vec &start_point)
 {
-    if (start_point.n_elem != S.n_cols || y.n_elem != S.n_cols)
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
     {
         MoMALogger::error("Wrong dimension in PRsolver::solve");
     }
-    double tol     = 1;
-    int iter       = 0;
-    arma::vec u    = start_point;
-    arma::vec newu = start_point;
-    arma::vec oldu;  // store working result
+    if (has_closed_form())
+    {
+        return closed_form_solve(y);
+    }
+    double tol = 1;
+    int iter   = 0;
+    work_u     = start_point;
+    work_newu  = start_point;
 
     double t = 1;
     while (tol > EPS && iter < MAX_ITER)
     {
         iter++;
-        oldu        = u;
+        work_u.swap(work_oldu);  // store working result
         double oldt = t;
         t           = 0.5 * (1 + std::sqrt(1 + 4 * oldt * oldt));
 
-        u    = g(newu, y, grad_step_size, S, is_S_idmat);
-        u    = p(u, prox_step_size);
-        newu = u + (oldt - 1) / t * (u - oldu);
+        g(work_newu, y, grad_step_size, work_grad);
+        p.apply(work_grad, prox_step_size, work_u);
+        work_newu = work_u + (oldt - 1) / t * (work_u - work_oldu);
 
-        double old_norm  = arma::norm(oldu);
-        double diff_norm = arma::norm(u - oldu);
-        if (old_norm != 0.0)
-            tol = diff_norm / old_norm;
+        tol = relative_change(work_u, work_oldu);
+        if (iter % 1000 == 0)
+        {
+            MoMALogger::debug("Solving PR: No.") << iter << "--" << tol;
+        }
+    }
+    normalize(work_u);
+
+    check_convergence(iter, tol);
+    MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+        << "(" << iter << "," << tol << ")";
+    return work_u;
+}
+
+bool FISTA_BT::is_sufficient_decrease(const arma::vec &z, const arma::vec &x, double L_k)
+{
+    // work_grad is free after the prox step
+    work_grad       = z - x;
+    double d_norm2  = arma::dot(work_grad, work_grad);
+    double d_S_norm = is_S_idmat ? d_norm2 : d_norm2 + alpha * sp_quad_form(Omega, work_grad);
+    return d_S_norm <= L_k * d_norm2;
+}
+
+arma::vec FISTA_BT::solve(arma::vec y, const arma::vec &start_point)
+{
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+    {
+        MoMALogger::error("Wrong dimension in PRsolver::solve");
+    }
+    if (has_closed_form())
+    {
+        return closed_form_solve(y);
+    }
+    double tol = 1;
+    int iter   = 0;
+    int n_bt   = 0;  // number of rejected steps
+    int n_rs   = 0;  // number of restarts
+    work_u     = start_point;
+    work_newu  = start_point;
+
+    double t = 1;
+    while (tol > EPS && iter < MAX_ITER)
+    {
+        iter++;
+        work_u.swap(work_oldu);  // store working result
+        double oldt = t;
+        t           = 0.5 * (1 + std::sqrt(1 + 4 * oldt * oldt));
+
+        // Backtracking. S = I + alpha * Omega, so L_k >= 1.
+        double L_k = std::max(1.0, MOMA_FISTA_BT_SHRINK * L_local);
+        while (true)
+        {
+            g(work_newu, y, 1 / L_k, work_grad);
+            p.apply(work_grad, lambda / L_k, work_u);
+            if (L_k >= L || is_sufficient_decrease(work_u, work_newu, L_k))
+            {
+                break;
+            }
+            L_k = std::min(MOMA_FISTA_BT_GROW * L_k, L);
+            n_bt++;
+        }
+        L_local = L_k;
+
+        // Restart if the momentum makes an obtuse angle with the
+        // gradient step, i.e., (newu - u)^T (u - oldu) > 0
+        double angle = 0;
+        for (int i = 0; i < dim; i++)
+        {
+            angle += (work_newu(i) - work_u(i)) * (work_u(i) - work_oldu(i));
+        }
+        if (angle > 0)
+        {
+            t         = 1;
+            work_newu = work_u;
+            n_rs++;
+        }
         else
         {
-            tol = diff_norm;
+            work_newu = work_u + (oldt - 1) / t * (work_u - work_oldu);
         }
+
+        tol = relative_change(work_u, work_oldu);
         if (iter % 1000 == 0)
         {
             MoMALogger::debug("Solving PR: No.") << iter << "--" << tol;
         }
     }
-    u = normalize(u);
+    normalize(work_u);
 
     check_convergence(iter, tol);
     MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
-        << "(" << iter << "," << tol << ")";
-    return u;
+        << "(" << iter << "," << tol << "), " << n_bt << " backtracking steps, " << n_rs
+        << " restarts";
+    return work_u;
 }
 
-arma::vec OneStepISTA::solve(arma::vec y, const arma::vec &start_point)
+void ADMM::factorize()
+{
+    // The eigenvalues of S lie in [1, L], and rho = sqrt(L) balances
+    // the conditioning of the two subproblems
+    rho = std::sqrt(L);
+    S_rho.factorize(Omega, alpha, 1 + rho, is_S_idmat ? 0 : Omega_bandwidth);
+    factor_alpha = alpha;
+    MoMALogger::debug("Factorized S + rho * I: (alpha, rho, bandwidth) = ")
+        << "(" << alpha << "," << rho << "," << Omega_bandwidth << ")";
+}
+
+arma::vec ADMM::solve(arma::vec y, const arma::vec &start_point)
 {
-    if (start_point.n_elem != S.n_cols || y.n_elem != S.n_cols)
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
     {
         MoMALogger::error("Wrong dimension in PRsolver::solve");
     }
-    double tol  = 1;
-    int iter    = 0;
-    arma::vec u = start_point;
-    arma::vec oldu;  // store working result
+    if (has_closed_form())
+    {
+        return closed_form_solve(y);
+    }
+    if (factor_alpha != alpha)
+    {
+        factorize();
+    }
+    double tol = 1;
+    int iter   = 0;
+    // z lives in work_u, u in work_newu and the scaled dual variable w in work_grad
+    work_u = start_point;
+    work_grad.zeros();
 
     while (tol > EPS && iter < MAX_ITER)
     {
         iter++;
-        oldu = u;
+        work_u.swap(work_oldu);  // store working result
 
-        u = g(u, y, grad_step_size, S, is_S_idmat);
-        u = p(u, prox_step_size);
-        u = normalize(u);
+        work_newu = y + rho * (work_oldu - work_grad);
+        solve_S_rho(work_newu);
 
-        double old_norm  = arma::norm(oldu);
-        double diff_norm = arma::norm(u - oldu);
-        if (old_norm != 0.0)
-            tol = diff_norm / old_norm;
-        else
+        work_u = work_newu + work_grad;
+        p.apply(work_u, lambda / rho, work_u);
+
+        work_grad += work_newu - work_u;
+
+        // change of z, and the primal residual || u - z || / || z ||
+        tol = std::max(relative_change(work_u, work_oldu), relative_change(work_newu, work_u));
+        if (iter % 1000 == 0)
+        {
+            MoMALogger::debug("Solving PR: No.") << iter << "--" << tol;
+        }
+    }
+    normalize(work_u);
+
+    check_convergence(iter, tol);
+    MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+        << "(" << iter << "," << tol << ")";
+    return work_u;
+}
+
+EigenADMM::EigenADMM(double i_alpha,
+                     const arma::sp_mat &i_Omega,
+                     double i_lambda,
+                     Rcpp::List prox_arg_list,
+                     double i_EPS,
+                     int i_MAX_ITER,
+                     int dim)
+    : ADMM(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+      work_coef(dim),
+      is_null_prox(dynamic_cast<const NullProx *>(p.get()) != nullptr)
+{
+    MoMALogger::debug("Initializing an ADMM solver in the eigenbasis of Omega.");
+    if (!arma::eig_sym(Omega_d, Omega_V, arma::mat(Omega)))
+    {
+        MoMALogger::error("Failed to find the eigendecomposition of the smoothing matrix.");
+    }
+    // reused by set_step_size when alpha changes
+    Omega_lambda_max = std::max(Omega_d.max(), 0.0);
+}
+
+void EigenADMM::factorize()
+{
+    rho          = std::sqrt(L);
+    factor_alpha = alpha;
+}
+
+void EigenADMM::solve_S_rho(arma::vec &x)
+{
+    work_coef = Omega_V.t() * x;
+    for (int i = 0; i < dim; i++)
+    {
+        work_coef(i) /= 1 + rho + alpha * Omega_d(i);
+    }
+    x = Omega_V * work_coef;
+}
+
+arma::vec EigenADMM::solve(arma::vec y, const arma::vec &start_point)
+{
+    if (!is_null_prox || is_S_idmat)
+    {
+        return ADMM::solve(y, start_point);
+    }
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+    {
+        MoMALogger::error("Wrong dimension in PRsolver::solve");
+    }
+    // u = S^{-1} y
+    work_coef = Omega_V.t() * y;
+    for (int i = 0; i < dim; i++)
+    {
+        work_coef(i) /= 1 + alpha * Omega_d(i);
+    }
+    work_u = Omega_V * work_coef;
+    normalize(work_u);
+    last_iter = 0;
+    MoMALogger::debug("Solved PR in the eigenbasis of Omega.");
+    return work_u;
+}
+
+SSNAL::SSNAL(double i_alpha,
+             const arma::sp_mat &i_Omega,
+             double i_lambda,
+             Rcpp::List prox_arg_list,
+             double i_EPS,
+             int i_MAX_ITER,
+             int dim)
+    : _PR_solver(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+      sigma(1),
+      work_w(dim),
+      work_x(dim),
+      work_d(dim),
+      work_trial_u(dim),
+      work_trial_x(dim),
+      work_trial_z(dim),
+      work_r(dim),
+      work_p(dim),
+      work_Hp(dim),
+      work_Jp(dim)
+{
+    MoMALogger::debug("Initializing a SSNAL solver.");
+    if (!p.has_jacobian())
+    {
+        MoMALogger::error("SSNAL does not support this penalty.");
+    }
+}
+
+double SSNAL::phi(const arma::vec &y, const arma::vec &u, arma::vec &x, arma::vec &z)
+{
+    x = u + work_w / sigma;
+    p.apply(x, lambda / sigma, z);
+    double dist = 0;
+    for (int i = 0; i < dim; i++)
+    {
+        dist += (z(i) - x(i)) * (z(i) - x(i));
+    }
+    double Su = S_norm(u);
+    return 0.5 * Su * Su - arma::dot(y, u) + lambda * p.value(z) + 0.5 * sigma * dist;
+}
+
+void SSNAL::grad_phi(const arma::vec &y,
+                     const arma::vec &u,
+                     const arma::vec &x,
+                     const arma::vec &z,
+                     arma::vec &out)
+{
+    out = u - y + sigma * (x - z);
+    if (!is_S_idmat)
+    {
+        sp_times_add(Omega, u, alpha, out);
+    }
+}
+
+int SSNAL::newton_direction(const arma::vec &x,
+                            const arma::vec &z,
+                            const arma::vec &grad,
+                            double tol)
+{
+    work_d.zeros();
+    work_r    = -grad;
+    work_p    = work_r;
+    double rr = arma::dot(work_r, work_r);
+    int k     = 0;
+    while (std::sqrt(rr) > tol && k < dim)
+    {
+        // Hp = (S + sigma (I - J)) p
+        p.jacobian_times(x, z, lambda / sigma, work_p, work_Jp);
+        work_Hp = (1 + sigma) * work_p - sigma * work_Jp;
+        if (!is_S_idmat)
         {
-            tol = diff_norm;
+            sp_times_add(Omega, work_p, alpha, work_Hp);
         }
 
+        double a = rr / arma::dot(work_p, work_Hp);
+        work_d += a * work_p;
+        work_r -= a * work_Hp;
+        double new_rr = arma::dot(work_r, work_r);
+        work_p        = work_r + (new_rr / rr) * work_p;
+        rr            = new_rr;
+        k++;
+    }
+    return k;
+}
+
+arma::vec SSNAL::solve(arma::vec y, const arma::vec &start_point)
+{
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+    {
+        MoMALogger::error("Wrong dimension in PRsolver::solve");
+    }
+    if (has_closed_form())
+    {
+        return closed_form_solve(y);
+    }
+    double tol   = 1;
+    int iter     = 0;  // number of ALM iterations and Newton steps
+    int n_outer  = 0;
+    int n_cg     = 0;
+    double ynorm = arma::norm(y);
+
+    // z lives in work_u, u in work_newu, and the previous z in work_oldu
+    sigma     = 1;
+    work_newu = start_point;
+    work_oldu = start_point;
+    work_w.zeros();
+    double phi_u = phi(y, work_newu, work_x, work_u);
+
+    while (tol > EPS && iter < MAX_ITER)
+    {
+        // Count the ALM iteration itself, so that the loop stops even if
+        // phi needs no Newton step
+        iter++;
+        n_outer++;
+        // Minimize phi by semi-smooth Newton, to a precision that
+        // tightens with the outer iterations
+        double inner_eps = std::max(0.1 * EPS, std::pow(0.1, n_outer)) * (1 + ynorm);
+        while (iter < MAX_ITER)
+        {
+            grad_phi(y, work_newu, work_x, work_u, work_grad);
+            double grad_norm = arma::norm(work_grad);
+            if (grad_norm <= inner_eps)
+            {
+                break;
+            }
+            iter++;
+            n_cg += newton_direction(work_x, work_u, work_grad,
+                                     std::min(0.1, std::sqrt(grad_norm)) * grad_norm);
+
+            // Armijo line search on phi
+            double slope = arma::dot(work_grad, work_d);
+            double t     = 1;
+            double phi_t = phi_u;
+            for (int k = 0; k < MOMA_SSNAL_MAX_LINESEARCH; k++)
+            {
+                work_trial_u = work_newu + t * work_d;
+                phi_t        = phi(y, work_trial_u, work_trial_x, work_trial_z);
+                if (phi_t <= phi_u + 1e-4 * t * slope)
+                {
+                    break;
+                }
+                t /= 2;
+            }
+            work_newu.swap(work_trial_u);
+            work_x.swap(work_trial_x);
+            work_u.swap(work_trial_z);
+            phi_u = phi_t;
+        }
+
+        // w = w + sigma (u - z) = sigma (x - z)
+        work_w = sigma * (work_x - work_u);
+
+        // change of z, and the primal residual || u - z || / || z ||
+        tol = std::max(relative_change(work_u, work_oldu), relative_change(work_newu, work_u));
+
+        work_oldu = work_u;
+
+        sigma = std::min(MOMA_SSNAL_SIGMA_GROW * sigma, MOMA_SSNAL_SIGMA_MAX);
+        phi_u = phi(y, work_newu, work_x, work_u);
+    }
+    normalize(work_u);
+
+    check_convergence(iter, tol);
+    MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+        << "(" << iter << "," << tol << "), " << n_outer << " ALM iterations, " << n_cg
+        << " CG iterations";
+    return work_u;
+}
+
+arma::vec OneStepISTA::solve(arma::vec y, const arma::vec &start_point)
+{
+    if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+    {
+        MoMALogger::error("Wrong dimension in PRsolver::solve");
+    }
+    double tol = 1;
+    int iter   = 0;
+    work_u     = start_point;
+
+    while (tol > EPS && iter < MAX_ITER)
+    {
+        iter++;
+        work_u.swap(work_oldu);  // store working result
+
+        g(work_oldu, y, grad_step_size, work_grad);
+        p.apply(work_grad, prox_step_size, work_u);
+        normalize(work_u);
+
+        tol = relative_change(work_u, work_oldu);
         if (iter % 1000 == 0)
         {
             MoMALogger::debug("Solving PR: No.") << iter << "--" << tol;
@@ -242,12 +733,80 @@ arma::vec OneStepISTA::solve(arma::vec y, const arma::vec &start_point)
     check_convergence(iter, tol);
     MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
         << "(" << iter << "," << tol << ")";
-    return u;
+    return work_u;
+}
+
+// Pick the specialization of a solver for separable penalties, and
+// fall back to the generic solver, which calls the prox through `ProxOp`
+template <template <typename> class Separable, typename Generic>
+_PR_solver *new_PR_solver(double i_alpha,
+                          const arma::sp_mat &i_Omega,
+                          double i_lambda,
+                          Rcpp::List prox_arg_list,
+                          double i_EPS,
+                          int i_MAX_ITER,
+                          int dim)
+{
+    const std::string &s = Rcpp::as<std::string>(prox_arg_list["P"]);
+    bool nonneg          = Rcpp::as<bool>(prox_arg_list["nonneg"]);
+    if (s.compare("NONE") == 0)
+    {
+        return new Separable<NullProx>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS,
+                                       i_MAX_ITER, dim);
+    }
+    else if (s.compare("LASSO") == 0 && nonneg)
+    {
+        return new Separable<NonNegativeLasso>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS,
+                                               i_MAX_ITER, dim);
+    }
+    else if (s.compare("LASSO") == 0)
+    {
+        return new Separable<Lasso>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER,
+                                    dim);
+    }
+    else if (s.compare("SCAD") == 0 && nonneg)
+    {
+        return new Separable<NonNegativeSCAD>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS,
+                                              i_MAX_ITER, dim);
+    }
+    else if (s.compare("SCAD") == 0)
+    {
+        return new Separable<SCAD>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER,
+                                   dim);
+    }
+    else if (s.compare("MCP") == 0 && nonneg)
+    {
+        return new Separable<NonNegativeMCP>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS,
+                                             i_MAX_ITER, dim);
+    }
+    else if (s.compare("MCP") == 0)
+    {
+        return new Separable<MCP>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER,
+                                  dim);
+    }
+    return new Generic(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+}
+
+// Whether `new_PR_solver` picks a specialization for the penalty
+bool is_separable_penalty(Rcpp::List prox_arg_list)
+{
+    const std::string &s = Rcpp::as<std::string>(prox_arg_list["P"]);
+    return s.compare("NONE") == 0 || s.compare("LASSO") == 0 || s.compare("SCAD") == 0 ||
+           s.compare("MCP") == 0;
+}
+
+// Whether the penalty scales with the step size of the proximal operator. The
+// sparse fused lasso thresholds at an absolute `lambda2` regardless of the step,
+// so ADMM, whose prox steps are lambda / rho, would solve a different problem.
+bool is_step_consistent_penalty(Rcpp::List prox_arg_list)
+{
+    const std::string &s = Rcpp::as<std::string>(prox_arg_list["P"]);
+    return s.compare("SPARSEFUSEDLASSO") != 0;
 }
 
 PR_solver::PR_solver(const std::string &algorithm_string,
                      double i_alpha,
-                     const arma::mat &i_Omega,
+                     const arma::sp_mat &i_Omega,
                      double i_lambda,
                      Rcpp::List prox_arg_list,
                      double i_EPS,
@@ -256,15 +815,73 @@ PR_solver::PR_solver(const std::string &algorithm_string,
 {
     if (algorithm_string.compare("ISTA") == 0)
     {
-        prs = new ISTA(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+        prs = new_PR_solver<SeparableISTA, ISTA>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS,
+                                                 i_MAX_ITER, dim);
     }
     else if (algorithm_string.compare("FISTA") == 0)
     {
-        prs = new FISTA(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+        prs = new_PR_solver<SeparableFISTA, FISTA>(i_alpha, i_Omega, i_lambda, prox_arg_list,
+                                                   i_EPS, i_MAX_ITER, dim);
+    }
+    else if (algorithm_string.compare("FISTA_BT") == 0)
+    {
+        prs = new FISTA_BT(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+    }
+    else if ((algorithm_string.compare("ADMM") == 0 ||
+              algorithm_string.compare("ADMM_EIGEN") == 0) &&
+             !is_step_consistent_penalty(prox_arg_list))
+    {
+        MoMALogger::warning("ADMM does not support the sparse fused lasso penalty. ")
+            << "Using FISTA instead.";
+        prs = new_PR_solver<SeparableFISTA, FISTA>(i_alpha, i_Omega, i_lambda, prox_arg_list,
+                                                   i_EPS, i_MAX_ITER, dim);
+    }
+    else if (algorithm_string.compare("ADMM") == 0)
+    {
+        prs = new ADMM(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+    }
+    else if (algorithm_string.compare("ADMM_EIGEN") == 0)
+    {
+        prs = new EigenADMM(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+    }
+    else if (algorithm_string.compare("SSNAL") == 0)
+    {
+        if (ProxOp(prox_arg_list, dim).has_jacobian())
+        {
+            prs = new SSNAL(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+        }
+        else
+        {
+            MoMALogger::warning("SSNAL only supports lasso, group lasso and ordered fused lasso ")
+                << "penalties. Using FISTA instead.";
+            prs = new_PR_solver<SeparableFISTA, FISTA>(i_alpha, i_Omega, i_lambda, prox_arg_list,
+                                                       i_EPS, i_MAX_ITER, dim);
+        }
+    }
+    else if (algorithm_string.compare("CD") == 0)
+    {
+        if (!is_separable_penalty(prox_arg_list))
+        {
+            MoMALogger::warning("Coordinate descent only supports separable penalties. ")
+                << "Using FISTA instead.";
+        }
+        prs = new_PR_solver<CD, FISTA>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS,
+                                       i_MAX_ITER, dim);
+    }
+    else if (algorithm_string.compare("ACTIVESET") == 0)
+    {
+        if (!is_separable_penalty(prox_arg_list))
+        {
+            MoMALogger::warning("The active-set solver only supports separable penalties. ")
+                << "Using FISTA instead.";
+        }
+        prs = new_PR_solver<ActiveSetCD, FISTA>(i_alpha, i_Omega, i_lambda, prox_arg_list,
+                                                i_EPS, i_MAX_ITER, dim);
     }
     else if (algorithm_string.compare("ONESTEPISTA") == 0)
     {
-        prs = new OneStepISTA(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
+        prs = new_PR_solver<SeparableOneStepISTA, OneStepISTA>(
+            i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim);
     }
     else
     {
@@ -286,3 +903,18 @@ double PR_solver::bic(arma::vec y, const arma::vec &est)
 {
     return (*prs).bic(y, est);
 }
+
+double PR_solver::S_norm(const arma::vec &u)
+{
+    return (*prs).S_norm(u);
+}
+
+int PR_solver::iterations() const
+{
+    return (*prs).iterations();
+}
+
+void PR_solver::set_EPS(double new_EPS)
+{
+    (*prs).set_EPS(new_EPS);
+}
@@ -7,6 +7,74 @@
 #include "moma_base.h"
 #include "moma_logging.h"
 #include "moma_prox.h"
+#include "moma_lanczos.h"
+
+// Products with a sparse matrix in compressed sparse column format
+// without temporaries. A has to be synced (see `arma::SpMat::sync`).
+
+// out = out + a * A v
+inline void sp_times_add(const arma::sp_mat &A, const arma::vec &v, double a, arma::vec &out)
+{
+    for (arma::uword j = 0; j < A.n_cols; j++)
+    {
+        double avj = a * v(j);
+        for (arma::uword k = A.col_ptrs[j]; k < A.col_ptrs[j + 1]; k++)
+        {
+            out(A.row_indices[k]) += A.values[k] * avj;
+        }
+    }
+}
+
+// u^T A u
+inline double sp_quad_form(const arma::sp_mat &A, const arma::vec &u)
+{
+    double res = 0;
+    for (arma::uword j = 0; j < A.n_cols; j++)
+    {
+        for (arma::uword k = A.col_ptrs[j]; k < A.col_ptrs[j + 1]; k++)
+        {
+            res += u(A.row_indices[k]) * A.values[k] * u(j);
+        }
+    }
+    return res;
+}
+
+// || u - oldu || / || oldu ||, or || u - oldu || if oldu = 0
+inline double relative_change(const arma::vec &u, const arma::vec &oldu)
+{
+    double old_norm  = 0;
+    double diff_norm = 0;
+    for (arma::uword i = 0; i < u.n_elem; i++)
+    {
+        old_norm += oldu(i) * oldu(i);
+        diff_norm += (u(i) - oldu(i)) * (u(i) - oldu(i));
+    }
+    old_norm  = std::sqrt(old_norm);
+    diff_norm = std::sqrt(diff_norm);
+    return old_norm != 0.0 ? diff_norm / old_norm : diff_norm;
+}
+
+// Cholesky factorization L L^T of c * I + a * A, where A is symmetric
+// with bandwidth b, i.e., A(i, j) = 0 if |i - j| > b. L has the same
+// bandwidth, so factorizing costs O(n b^2) and a solve O(n b). Smoothing
+// matrices are usually banded (b = 2 for the second difference matrix);
+// a general matrix simply has b = n - 1.
+class BandedCholesky
+{
+  private:
+    int n;
+    int b;
+    arma::mat band;  // band(i - j, j) = L(i, j) for 0 <= i - j <= b
+
+  public:
+    BandedCholesky() : n(0), b(0){};
+    void factorize(const arma::sp_mat &A, double a, double c, int bandwidth);
+    // x = (L L^T)^{-1} x in place
+    void solve(arma::vec &x) const;
+};
+
+// max |i - j| over the non-zero entries A(i, j)
+int bandwidth(const arma::sp_mat &A);
 
 // Penalized regression solver
 // min_u || y - u || + lambda * P(u) s.t. || u ||_S <= 1
@@ -18,10 +86,15 @@ class _PR_solver
     double lambda;
     double alpha;
     double L;
-    const arma::mat &Omega;
-    // S = I + alpha * Omega for u, v smoothing
-    arma::mat S;
+    // Smoothing matrices are usually banded (e.g., the second difference
+    // matrix), so we store Omega as a sparse matrix and never form
+    // S = I + alpha * Omega: products with S cost O(nnz(Omega)).
+    arma::sp_mat Omega;
     bool is_S_idmat;  // indicator of alpha == 0.0 <=> S == I
+    // The leading eigenvalue of Omega, negative if not computed yet.
+    // It does not depend on alpha, and the leading eigenvalue of S is
+    // 1 + alpha * Omega_lambda_max, so changing alpha costs O(1).
+    double Omega_lambda_max;
 
     // Step size for proximal gradient algorithm
     //   - since this is a linear model internally, we can used a fixed
@@ -32,23 +105,75 @@ class _PR_solver
     //
     // Note that currently the threshold level is not defined in the Prox object
     ProxOp p;
-    // A gradient operator
-    arma::vec g(const arma::vec &v,
-                const arma::vec &y,
-                double step_size,
-                const arma::mat &S,
-                bool is_S_idmat);
-    arma::vec normalize(const arma::vec &u);
+    // A gradient operator, out = v + step_size * (y - S v).
+    // `out` must not alias `v`.
+    void g(const arma::vec &v, const arma::vec &y, double step_size, arma::vec &out);
+    // Scale u to unit S-norm in place
+    void normalize(arma::vec &u);
+    // Without smoothing (S = I) and with a norm-like penalty, the PR
+    // problem is solved exactly by normalize(prox(y, lambda)), see
+    // `Prox::is_norm_like`. Then ISTA and FISTA skip their loops.
+    bool has_closed_form();
+    arma::vec closed_form_solve(const arma::vec &y);
+
+    // out = prox(v + grad_step_size * (y - S v), prox_step_size) for a
+    // separable penalty P (see `NullProx::threshold`), fused into a single
+    // pass together with the convergence check. Returns the relative change
+    // of `out` w.r.t. `ref`. `out` must not alias `v` or `ref`.
+    template <typename P>
+    double fused_step(const P &prox,
+                      const arma::vec &v,
+                      const arma::vec &y,
+                      arma::vec &out,
+                      const arma::vec &ref)
+    {
+        const double *Sv = nullptr;
+        if (!is_S_idmat)
+        {
+            // alpha * Omega v, the only part that is not element-wise
+            work_grad.zeros();
+            sp_times_add(Omega, v, alpha, work_grad);
+            Sv = work_grad.memptr();
+        }
+        double old_norm  = 0;
+        double diff_norm = 0;
+        for (int i = 0; i < dim; i++)
+        {
+            double grad = y(i) - v(i) - (Sv == nullptr ? 0.0 : Sv[i]);
+            double z    = prox.threshold(v(i) + grad_step_size * grad, prox_step_size);
+            out(i)      = z;
+            old_norm += ref(i) * ref(i);
+            diff_norm += (z - ref(i)) * (z - ref(i));
+        }
+        old_norm  = std::sqrt(old_norm);
+        diff_norm = std::sqrt(diff_norm);
+        return old_norm != 0.0 ? diff_norm / old_norm : diff_norm;
+    }
+    // Set L and step sizes for the current alpha and lambda
+    void set_step_size();
+    double leading_eigenvalue_Omega();
 
     // user-specified precision and max iterations
     double EPS;
     int MAX_ITER;
 
+    // Workspace of the solvers, allocated once in the constructor,
+    // so that iterations never touch the heap. Iterates are passed
+    // around by swapping buffers instead of copying.
+    arma::vec work_u;     // current iterate
+    arma::vec work_oldu;  // previous iterate
+    arma::vec work_newu;  // extrapolated point, FISTA only
+    arma::vec work_grad;  // result of the gradient step
+
+    // number of iterations taken by the last call of solve,
+    // 0 if it was solved in closed form
+    int last_iter;
+
   public:
     explicit _PR_solver(
         // smoothness
         double i_alpha,
-        const arma::mat &i_Omega,
+        const arma::sp_mat &i_Omega,
         // sparsity
         double i_lambda,
         Rcpp::List prox_arg_list,
@@ -60,16 +185,21 @@ class _PR_solver
     // Used when solving for a bunch of lambda's and alpha's
     int set_penalty(double new_lambda, double new_alpha);
     double bic(arma::vec y, const arma::vec &est);
+    // || u ||_S = sqrt(u^T S u)
+    double S_norm(const arma::vec &u);
     virtual ~_PR_solver()                                              = default;
     virtual arma::vec solve(arma::vec y, const arma::vec &start_point) = 0;
     void check_convergence(int iter, double tol);
+    int iterations() const { return last_iter; }
+    // Change the precision of the following calls of solve
+    void set_EPS(double new_EPS) { EPS = new_EPS; }
 };
 
 class ISTA : public _PR_solver
 {
   public:
     ISTA(double i_alpha,
-         const arma::mat &i_Omega,
+         const arma::sp_mat &i_Omega,
          double i_lambda,
          Rcpp::List prox_arg_list,
          double i_EPS,
@@ -87,7 +217,7 @@ class FISTA : public _PR_solver
 {
   public:
     FISTA(double i_alpha,
-          const arma::mat &i_Omega,
+          const arma::sp_mat &i_Omega,
           double i_lambda,
           Rcpp::List prox_arg_list,
           double i_EPS,
@@ -101,11 +231,180 @@ class FISTA : public _PR_solver
     ~FISTA() { MoMALogger::debug("Releasing a FISTA object"); }
 };
 
+// FISTA with a backtracking estimate of the local Lipschitz constant
+// and gradient-based adaptive restart, see
+//   Beck, A., & Teboulle, M. (2009). A fast iterative shrinkage-thresholding
+//   algorithm for linear inverse problems. SIAM journal on imaging sciences.
+//   O'Donoghue, B., & Candes, E. (2015). Adaptive restart for accelerated
+//   gradient schemes. Foundations of computational mathematics.
+//
+// The global L = lambda_max(S) is only an upper bound of the curvature
+// along the iterates, so we try a step 1 / L_k with L_k <= L, shrinking
+// it again after every accepted step. The momentum is reset whenever it
+// points against the gradient step, which removes the oscillations
+// of FISTA.
+class FISTA_BT : public _PR_solver
+{
+  private:
+    // estimate of the local Lipschitz constant, kept across calls
+    // of solve since consecutive PR problems are alike
+    double L_local;
+    // sufficient decrease for the smooth part f(u) = u^T S u / 2 - y^T u
+    // at z = prox(x - grad f(x) / L_k). Since f is quadratic, it reduces
+    // to (z - x)^T S (z - x) <= L_k || z - x ||^2, which L_k = L always
+    // satisfies.
+    bool is_sufficient_decrease(const arma::vec &z, const arma::vec &x, double L_k);
+
+  public:
+    FISTA_BT(double i_alpha,
+             const arma::sp_mat &i_Omega,
+             double i_lambda,
+             Rcpp::List prox_arg_list,
+             double i_EPS,
+             int i_MAX_ITER,
+             int dim)
+        : _PR_solver(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          L_local(1)
+    {
+        MoMALogger::debug("Initializing a FISTA solver with backtracking.");
+    };
+    arma::vec solve(arma::vec y, const arma::vec &start_point);
+    ~FISTA_BT() { MoMALogger::debug("Releasing a FISTA_BT object"); }
+};
+
+// ADMM on the splitting u = z, i.e.,
+//   u = (S + rho I)^{-1} (y + rho (z - w))
+//   z = prox(u + w, lambda / rho)
+//   w = w + u - z
+// The condition number of S grows with alpha, which slows down ISTA
+// and FISTA, while ADMM only sees S through the linear solve. The
+// factorization of S + rho I depends on alpha only: it is computed
+// when `solve` meets a new alpha and reused across all lambda's.
+class ADMM : public _PR_solver
+{
+  private:
+    int Omega_bandwidth;
+    BandedCholesky S_rho;  // S + rho * I
+
+  protected:
+    double rho;
+    double factor_alpha;  // alpha of the cached factorization, negative if none
+    // Set rho and prepare solve_S_rho for the current alpha
+    virtual void factorize();
+    // x = (S + rho I)^{-1} x in place
+    virtual void solve_S_rho(arma::vec &x) { S_rho.solve(x); }
+
+  public:
+    ADMM(double i_alpha,
+         const arma::sp_mat &i_Omega,
+         double i_lambda,
+         Rcpp::List prox_arg_list,
+         double i_EPS,
+         int i_MAX_ITER,
+         int dim)
+        : _PR_solver(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          Omega_bandwidth(bandwidth(Omega)),
+          rho(1),
+          factor_alpha(-1)
+    {
+        MoMALogger::debug("Initializing an ADMM solver.");
+    };
+    arma::vec solve(arma::vec y, const arma::vec &start_point);
+    ~ADMM() { MoMALogger::debug("Releasing an ADMM object"); }
+};
+
+// ADMM with the linear solve done in the eigenbasis of Omega = V D V^T,
+// where S + rho I = V (I + rho I + alpha D) V^T is diagonal. The
+// eigendecomposition is computed once in the constructor and serves
+// every alpha and rho, so that changing alpha costs O(1) and a solve
+// O(dim^2). It costs O(dim^2) memory, hence is meant for smoothing
+// matrices of moderate size, e.g., functional data on a grid.
+//
+// Without a sparsity penalty, whose prox commutes with rotations, the
+// PR problem is solved directly by u = V (I + alpha D)^{-1} V^T y.
+class EigenADMM : public ADMM
+{
+  private:
+    arma::mat Omega_V;    // eigenvectors of Omega
+    arma::vec Omega_d;    // eigenvalues of Omega
+    arma::vec work_coef;  // coefficients in the eigenbasis
+    bool is_null_prox;
+    void factorize();
+    void solve_S_rho(arma::vec &x);
+
+  public:
+    EigenADMM(double i_alpha,
+              const arma::sp_mat &i_Omega,
+              double i_lambda,
+              Rcpp::List prox_arg_list,
+              double i_EPS,
+              int i_MAX_ITER,
+              int dim);
+    arma::vec solve(arma::vec y, const arma::vec &start_point);
+    ~EigenADMM() { MoMALogger::debug("Releasing an EigenADMM object"); }
+};
+
+// Semi-smooth Newton augmented Lagrangian method (SSNAL), see
+//   Li, X., Sun, D., & Toh, K. C. (2018). A highly efficient semismooth
+//   Newton augmented Lagrangian method for solving Lasso problems. SIAM
+//   Journal on Optimization.
+//
+// The constraint u = z is handled by the augmented Lagrangian. Minimizing
+// it over z leaves
+//   phi(u) = f(u) + lambda P(z) + sigma / 2 || z - x ||^2,
+//   x = u + w / sigma,  z = prox(x, lambda / sigma),
+// where f(u) = u^T S u / 2 - y^T u. phi is convex and its gradient
+//   S u - y + sigma (x - z)
+// is semi-smooth, so it is minimized by Newton's method with the
+// generalized Hessian S + sigma (I - J), J being the generalized Jacobian
+// of the prox (see `Prox::jacobian_times`). The Newton systems are solved
+// by conjugate gradient. Then the multiplier is updated by
+// w = w + sigma (u - z). The method converges superlinearly, so that it
+// pays off for tight tolerances.
+class SSNAL : public _PR_solver
+{
+  private:
+    double sigma;
+    arma::vec work_w;  // multiplier
+    arma::vec work_x;  // u + w / sigma
+    arma::vec work_d;  // Newton direction
+    arma::vec work_trial_u;
+    arma::vec work_trial_x;
+    arma::vec work_trial_z;
+    arma::vec work_r;   // CG residual
+    arma::vec work_p;   // CG search direction
+    arma::vec work_Hp;  // Hessian times work_p
+    arma::vec work_Jp;  // Jacobian times work_p
+
+    // Evaluate phi(u), setting x and z accordingly
+    double phi(const arma::vec &y, const arma::vec &u, arma::vec &x, arma::vec &z);
+    // out = S u - y + sigma (x - z)
+    void grad_phi(const arma::vec &y,
+                  const arma::vec &u,
+                  const arma::vec &x,
+                  const arma::vec &z,
+                  arma::vec &out);
+    // Solve (S + sigma (I - J)) d = -grad up to a residual of `tol` by
+    // conjugate gradient. Returns the number of CG iterations.
+    int newton_direction(const arma::vec &x, const arma::vec &z, const arma::vec &grad, double tol);
+
+  public:
+    SSNAL(double i_alpha,
+          const arma::sp_mat &i_Omega,
+          double i_lambda,
+          Rcpp::List prox_arg_list,
+          double i_EPS,
+          int i_MAX_ITER,
+          int dim);
+    arma::vec solve(arma::vec y, const arma::vec &start_point);
+    ~SSNAL() { MoMALogger::debug("Releasing a SSNAL object"); }
+};
+
 class OneStepISTA : public _PR_solver
 {
   public:
     OneStepISTA(double i_alpha,
-                const arma::mat &i_Omega,
+                const arma::sp_mat &i_Omega,
                 double i_lambda,
                 Rcpp::List prox_arg_list,
                 double i_EPS,
@@ -119,6 +418,370 @@ class OneStepISTA : public _PR_solver
     ~OneStepISTA() { MoMALogger::debug("Releasing a OneStepISTA object"); }
 };
 
+// ISTA, FISTA and one-step ISTA specialized for a separable penalty P at
+// compile time. The prox is called without virtual dispatch and inlined
+// into the loop, see `_PR_solver::fused_step`. `PR_solver::PR_solver`
+// picks the specialization once.
+template <typename P>
+class SeparableISTA : public ISTA
+{
+  private:
+    const P &prox;
+
+  public:
+    SeparableISTA(double i_alpha,
+                  const arma::sp_mat &i_Omega,
+                  double i_lambda,
+                  Rcpp::List prox_arg_list,
+                  double i_EPS,
+                  int i_MAX_ITER,
+                  int dim)
+        : ISTA(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          prox(dynamic_cast<const P &>(*p.get())){};
+
+    arma::vec solve(arma::vec y, const arma::vec &start_point)
+    {
+        if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+        {
+            MoMALogger::error("Wrong dimension in PRsolver::solve");
+        }
+        if (has_closed_form())
+        {
+            return closed_form_solve(y);
+        }
+        double tol = 1;
+        int iter   = 0;
+        work_u     = start_point;
+        while (tol > EPS && iter < MAX_ITER)
+        {
+            iter++;
+            work_u.swap(work_oldu);
+            tol = fused_step(prox, work_oldu, y, work_u, work_oldu);
+        }
+        normalize(work_u);
+
+        MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+            << "(" << iter << "," << tol << ")";
+        check_convergence(iter, tol);
+        return work_u;
+    }
+};
+
+template <typename P>
+class SeparableFISTA : public FISTA
+{
+  private:
+    const P &prox;
+
+  public:
+    SeparableFISTA(double i_alpha,
+                   const arma::sp_mat &i_Omega,
+                   double i_lambda,
+                   Rcpp::List prox_arg_list,
+                   double i_EPS,
+                   int i_MAX_ITER,
+                   int dim)
+        : FISTA(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          prox(dynamic_cast<const P &>(*p.get())){};
+
+    arma::vec solve(arma::vec y, const arma::vec &start_point)
+    {
+        if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+        {
+            MoMALogger::error("Wrong dimension in PRsolver::solve");
+        }
+        if (has_closed_form())
+        {
+            return closed_form_solve(y);
+        }
+        double tol = 1;
+        int iter   = 0;
+        work_u     = start_point;
+        work_newu  = start_point;
+
+        double t = 1;
+        while (tol > EPS && iter < MAX_ITER)
+        {
+            iter++;
+            work_u.swap(work_oldu);
+            double oldt = t;
+            t           = 0.5 * (1 + std::sqrt(1 + 4 * oldt * oldt));
+
+            tol       = fused_step(prox, work_newu, y, work_u, work_oldu);
+            work_newu = work_u + (oldt - 1) / t * (work_u - work_oldu);
+        }
+        normalize(work_u);
+
+        check_convergence(iter, tol);
+        MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+            << "(" << iter << "," << tol << ")";
+        return work_u;
+    }
+};
+
+template <typename P>
+class SeparableOneStepISTA : public OneStepISTA
+{
+  private:
+    const P &prox;
+
+  public:
+    SeparableOneStepISTA(double i_alpha,
+                         const arma::sp_mat &i_Omega,
+                         double i_lambda,
+                         Rcpp::List prox_arg_list,
+                         double i_EPS,
+                         int i_MAX_ITER,
+                         int dim)
+        : OneStepISTA(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          prox(dynamic_cast<const P &>(*p.get())){};
+
+    arma::vec solve(arma::vec y, const arma::vec &start_point)
+    {
+        if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+        {
+            MoMALogger::error("Wrong dimension in PRsolver::solve");
+        }
+        double tol = 1;
+        int iter   = 0;
+        work_u     = start_point;
+        while (tol > EPS && iter < MAX_ITER)
+        {
+            iter++;
+            work_u.swap(work_oldu);
+            fused_step(prox, work_oldu, y, work_u, work_oldu);
+            // the change is measured after normalization
+            normalize(work_u);
+            tol = relative_change(work_u, work_oldu);
+        }
+
+        check_convergence(iter, tol);
+        MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+            << "(" << iter << "," << tol << ")";
+        return work_u;
+    }
+};
+
+// Cyclic coordinate descent for a separable penalty P. Coordinate j is
+// minimized exactly, i.e., u_j = prox(u_j + r_j / S_jj, lambda / S_jj),
+// where the residual r = y - S u is updated incrementally, so that an
+// update costs O(nnz of the j-th column of Omega) and a coordinate that
+// stays put costs O(1). A sweep over all coordinates counts as one
+// iteration. `PR_solver::PR_solver` falls back to FISTA for penalties
+// that are not separable.
+template <typename P>
+class CD : public _PR_solver
+{
+  protected:
+    const P &prox;
+    arma::vec Omega_diag;
+
+    // Set the residual r = y - S u, kept in work_grad, for u = work_u
+    void init_residual(const arma::vec &y)
+    {
+        work_grad = y - work_u;
+        if (!is_S_idmat)
+        {
+            sp_times_add(Omega, work_u, -alpha, work_grad);
+        }
+    }
+
+    // Minimize over u_j and update the residual. Returns the change of u_j.
+    double update_coordinate(int j)
+    {
+        double uj  = work_u(j);
+        double Sjj = 1 + alpha * Omega_diag(j);
+        double z   = prox.threshold(uj + work_grad(j) / Sjj, lambda / Sjj);
+        if (z != uj)
+        {
+            // r = r - (z - u_j) * S e_j
+            double delta = z - uj;
+            work_u(j)    = z;
+            work_grad(j) -= delta;
+            if (!is_S_idmat)
+            {
+                for (arma::uword k = Omega.col_ptrs[j]; k < Omega.col_ptrs[j + 1]; k++)
+                {
+                    work_grad(Omega.row_indices[k]) -= alpha * Omega.values[k] * delta;
+                }
+            }
+        }
+        return z - uj;
+    }
+
+  public:
+    CD(double i_alpha,
+       const arma::sp_mat &i_Omega,
+       double i_lambda,
+       Rcpp::List prox_arg_list,
+       double i_EPS,
+       int i_MAX_ITER,
+       int dim)
+        : _PR_solver(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          prox(dynamic_cast<const P &>(*p.get())),
+          Omega_diag(arma::vec(Omega.diag()))
+    {
+        MoMALogger::debug("Initializing a coordinate descent solver.");
+    };
+
+    arma::vec solve(arma::vec y, const arma::vec &start_point)
+    {
+        if ((int)start_point.n_elem != dim || (int)y.n_elem != dim)
+        {
+            MoMALogger::error("Wrong dimension in PRsolver::solve");
+        }
+        if (has_closed_form())
+        {
+            return closed_form_solve(y);
+        }
+        double tol = 1;
+        int iter   = 0;
+        work_u     = start_point;
+        init_residual(y);
+
+        while (tol > EPS && iter < MAX_ITER)
+        {
+            iter++;
+            double old_norm  = 0;
+            double diff_norm = 0;
+            for (int j = 0; j < dim; j++)
+            {
+                old_norm += work_u(j) * work_u(j);
+                double delta = update_coordinate(j);
+                diff_norm += delta * delta;
+            }
+            old_norm  = std::sqrt(old_norm);
+            diff_norm = std::sqrt(diff_norm);
+            tol       = old_norm != 0.0 ? diff_norm / old_norm : diff_norm;
+        }
+        normalize(work_u);
+
+        check_convergence(iter, tol);
+        MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+            << "(" << iter << "," << tol << ")";
+        return work_u;
+    }
+
+    ~CD() { MoMALogger::debug("Releasing a CD object"); }
+};
+
+// Coordinate descent restricted to a working set W, which starts as the
+// support of the start point (e.g., the warm start passed by the BIC
+// search) and grows by the violators of the KKT conditions:
+//   1. sweep over W until convergence;
+//   2. check the full KKT conditions, i.e., whether u_j = 0 is still the
+//      minimizer over u_j for every j outside W, which only reads the
+//      residual;
+//   3. add the violators to W and go to 1, or stop if there are none.
+// An iteration costs O(|W|) plus the non-zeros of Omega in those columns,
+// instead of O(dim + nnz(Omega)).
+template <typename P>
+class ActiveSetCD : public CD<P>
+{
+  private:
+    std::vector<int> working_set;
+    std::vector<bool> is_working;
+
+  public:
+    ActiveSetCD(double i_alpha,
+                const arma::sp_mat &i_Omega,
+                double i_lambda,
+                Rcpp::List prox_arg_list,
+                double i_EPS,
+                int i_MAX_ITER,
+                int dim)
+        : CD<P>(i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER, dim),
+          is_working(dim)
+    {
+        working_set.reserve(dim);
+        MoMALogger::debug("Initializing an active-set coordinate descent solver.");
+    };
+
+    arma::vec solve(arma::vec y, const arma::vec &start_point)
+    {
+        // members of a dependent base have to be named explicitly
+        const int n   = this->dim;
+        arma::vec &u  = this->work_u;
+        arma::vec &r  = this->work_grad;
+        if ((int)start_point.n_elem != n || (int)y.n_elem != n)
+        {
+            MoMALogger::error("Wrong dimension in PRsolver::solve");
+        }
+        if (this->has_closed_form())
+        {
+            return this->closed_form_solve(y);
+        }
+        double tol   = 1;
+        int iter     = 0;
+        int n_checks = 0;
+        u            = start_point;
+        this->init_residual(y);
+
+        working_set.clear();
+        for (int j = 0; j < n; j++)
+        {
+            is_working[j] = (u(j) != 0.0);
+            if (is_working[j])
+            {
+                working_set.push_back(j);
+            }
+        }
+
+        while (iter < this->MAX_ITER)
+        {
+            // 1. coordinate descent on the working set
+            tol = 1;
+            while (tol > this->EPS && iter < this->MAX_ITER)
+            {
+                iter++;
+                double old_norm  = 0;
+                double diff_norm = 0;
+                for (int j : working_set)
+                {
+                    old_norm += u(j) * u(j);
+                    double delta = this->update_coordinate(j);
+                    diff_norm += delta * delta;
+                }
+                old_norm  = std::sqrt(old_norm);
+                diff_norm = std::sqrt(diff_norm);
+                tol       = old_norm != 0.0 ? diff_norm / old_norm : diff_norm;
+            }
+
+            // 2. KKT conditions outside the working set, where u_j = 0
+            n_checks++;
+            int n_violators = 0;
+            for (int j = 0; j < n; j++)
+            {
+                if (is_working[j])
+                {
+                    continue;
+                }
+                double Sjj = 1 + this->alpha * this->Omega_diag(j);
+                if (this->prox.threshold(r(j) / Sjj, this->lambda / Sjj) != 0.0)
+                {
+                    // 3. grow the working set
+                    is_working[j] = true;
+                    working_set.push_back(j);
+                    n_violators++;
+                }
+            }
+            if (n_violators == 0)
+            {
+                break;
+            }
+        }
+        this->normalize(u);
+
+        this->check_convergence(iter, tol);
+        MoMALogger::debug("Finish solving PR: (total_iter, tol) = ")
+            << "(" << iter << "," << tol << "), " << n_checks << " KKT checks, working set of size "
+            << working_set.size();
+        return u;
+    }
+
+    ~ActiveSetCD() { MoMALogger::debug("Releasing an ActiveSetCD object"); }
+};
+
 // A handle class
 class PR_solver
 {
@@ -131,7 +794,7 @@ class PR_solver
         const std::string &algorithm_string,
         // same as class _PR_solver
         double i_alpha,
-        const arma::mat &i_Omega,
+        const arma::sp_mat &i_Omega,
         double i_lambda,
         Rcpp::List prox_arg_list,
         double i_EPS,
@@ -142,6 +805,10 @@ class PR_solver
     arma::vec solve(arma::vec y, const arma::vec &start_point);
     double bic(arma::vec y, const arma::vec &est);
     int set_penalty(double new_lambda, double new_alpha);
+    double S_norm(const arma::vec &u);
+    // number of iterations taken by the last call of PR_solver::solve
+    int iterations() const;
+    void set_EPS(double new_EPS);
 
     ~PR_solver() { delete prs; }
 };
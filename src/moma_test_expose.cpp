@@ -166,8 +166,36 @@ double test_BIC(const arma::vec y,
                 double i_EPS   = 1e-6,
                 int i_MAX_ITER = 1e+3)
 {
-    PR_solver solver(algorithm_string, i_alpha, i_Omega, i_lambda, prox_arg_list, i_EPS, i_MAX_ITER,
-                     dim);
+    PR_solver solver(algorithm_string, i_alpha, arma::sp_mat(i_Omega), i_lambda, prox_arg_list,
+                     i_EPS, i_MAX_ITER, dim);
 
     return solver.bic(y, y_est);
 }
+
+// [[Rcpp::export]]
+Rcpp::List test_lanczos_svd(const arma::mat &X, double tol = 1e-10)
+{
+    arma::vec u;
+    arma::vec v;
+    double d;
+    int status = leading_singular_triplet(DenseOperator(X), u, v, d, tol);
+    return Rcpp::List::create(Rcpp::Named("u") = u, Rcpp::Named("v") = v, Rcpp::Named("d") = d,
+                              Rcpp::Named("status") = status);
+}
+
+// [[Rcpp::export]]
+Rcpp::List test_PR_solver(const arma::vec &y,
+                          const arma::vec &start_point,
+                          const std::string &algorithm_string,
+                          double i_alpha,
+                          const arma::mat &i_Omega,
+                          double i_lambda,
+                          Rcpp::List prox_arg_list,
+                          double i_EPS   = 1e-10,
+                          int i_MAX_ITER = 1e+5)
+{
+    PR_solver solver(algorithm_string, i_alpha, arma::sp_mat(i_Omega), i_lambda, prox_arg_list,
+                     i_EPS, i_MAX_ITER, y.n_elem);
+    arma::vec u = solver.solve(y, start_point);
+    return Rcpp::List::create(Rcpp::Named("u") = u, Rcpp::Named("iter") = solver.iterations());
+}